@@ -0,0 +1,128 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+/**
+ *  A handler with a drained() callback, as a stage that queues writes
+ *  and flushes them once per burst would use.  Bursts published at once
+ *  must get exactly one drained() call each.  Under a steady stream the
+ *  producer checks after every event that drained() ran for every event
+ *  the reader has released, even though new events keep arriving as the
+ *  handler catches up.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+struct stage
+{
+   /** @param yield - yield in the handler, so that events can arrive while it runs even on one cpu */
+   stage( bool yield ):w( std::make_shared<write_cursor>("write",1024) ),
+                       r( std::make_shared<read_cursor>("read") ),
+                       yield_batches(yield),queued(0),flushed(0),drains(0)
+   {
+      r->follows(w);
+      w->follows(r);
+      r->start_at(-1);
+   }
+
+   void add_to( disruptor::thread& t )
+   {
+      t.add_cursor( r, [this]( int64_t begin, int64_t end ) 
+                       { 
+                          queued = end; 
+                          if( yield_batches ) sched_yield();
+                          return end; 
+                       },
+                       [this]() { flushed = queued; ++drains; } );
+   }
+
+   /** @return true if the reader has released events that drained() has not flushed */
+   bool released_unflushed()
+   {
+      auto released = r->pos().aquire() + 1;
+      return released > flushed.load();
+   }
+
+   write_cursor_ptr     w;
+   read_cursor_ptr      r;
+   bool                 yield_batches;
+   /** only touched by the thread */
+   int64_t              queued;
+   std::atomic<int64_t> flushed;
+   std::atomic<int64_t> drains;
+};
+
+/** @return true if each of bursts bursts of size events got exactly one drained() */
+bool bursts( int64_t count, int64_t size )
+{
+   disruptor::thread t;
+   stage s( false );
+   s.add_to(t);
+   t.start();
+
+   int64_t pos = s.w->begin();
+   for( int64_t b = 0; b < count; ++b )
+   {
+      s.w->wait_for( pos + size - 1 );
+      pos += size;
+      s.w->publish( pos - 1 );
+      while( s.drains.load() <= b ) usleep( 100 );
+   }
+   usleep( 10*1000 );
+   t.stop();
+   t.join();
+   std::cout << count << " bursts of " << size << " events, " << s.drains.load()
+             << " drained() calls" << std::endl;
+   return s.drains.load() == count && s.flushed.load() == pos;
+}
+
+/** @return events per second, or 0 if the reader released events before drained() flushed them */
+double stream( int64_t events )
+{
+   disruptor::thread t;
+   stage s( true );
+   s.add_to(t);
+   t.start();
+
+   int64_t early = 0;
+   double  start = now();
+   int64_t pos   = s.w->begin();
+   int64_t end   = s.w->end();
+   for( int64_t i = 0; i < events; ++i )
+   {
+      if( pos >= end ) end = s.w->wait_for( pos );
+      s.w->publish( pos++ );
+      // let the handler run, so that events arrive as it catches up
+      sched_yield();
+      early += s.released_unflushed();
+   }
+   while( s.flushed.load() < pos )
+   {
+      early += s.released_unflushed();
+      usleep( 100 );
+   }
+   double elapsed = now() - start;
+   t.stop();
+   t.join();
+   std::cout << events << " streamed events, " << s.drains.load() << " drained() calls, "
+             << early << " times events were released before drained()" << std::endl;
+   return early ? 0 : events / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t events = argc > 1 ? atoll( argv[1] ) : 1000 * 1000;
+
+   std::cout.precision(15);
+   bool right = bursts( 100, 500 );
+   double rate = stream( events );
+   std::cout << "streaming: " << rate << " ops/secs" << std::endl;
+   return !right || rate == 0;
+}
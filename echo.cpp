@@ -0,0 +1,61 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+/**
+ *  One disruptor::thread serves a socket and its post ring at once: it
+ *  echoes everything written to the other end of a socketpair and counts
+ *  the echoes in functors posted to it.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+int main( int argc, char** argv )
+{
+   int64_t iterations = 1000 * 100;
+
+   int s[2];
+   if( ::socketpair( AF_UNIX, SOCK_STREAM, 0, s ) != 0 ) { perror( "socketpair" ); return 1; }
+
+   disruptor::thread t;
+   std::atomic<int64_t> echoed( 0 );
+   t.add_fd( s[0], EPOLLIN, [&]( int fd, uint32_t events )
+   {
+      char buf[4096];
+      ssize_t n = ::read( fd, buf, sizeof(buf) );
+      if( n > 0 )
+      {
+         if( ::write( fd, buf, n ) != n ) perror( "write" );
+         t.post( [&,n]() { echoed += n / sizeof(int64_t); } );
+      }
+   });
+   t.start();
+
+   double start = now();
+   for( int64_t i = 0; i < iterations; ++i )
+   {
+      int64_t sent = i, received = -1;
+      if( ::write( s[1], &sent, sizeof(sent) ) != sizeof(sent) ) { perror( "write" ); return 1; }
+      if( ::read( s[1], &received, sizeof(received) ) != sizeof(received) ) { perror( "read" ); return 1; }
+      assert( received == sent );
+   }
+   double elapsed = now() - start;
+
+   // the last count may still be in the post ring
+   while( echoed.load() < iterations ) usleep( 1000 );
+   t.stop();
+   t.join();
+   std::cout.precision(15);
+   std::cout << "socketpair echo round trip: " << elapsed * 1000000000.0 / iterations << " ns, "
+             << echoed << " echoes counted\n";
+
+   ::close( s[0] );
+   ::close( s[1] );
+   return echoed == iterations ? 0 : 1;
+}
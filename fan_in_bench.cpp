@@ -0,0 +1,142 @@
+#include <disruptor/fan_in.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  N producers feed one consumer, either each through its own single
+ *  producer ring drained by a fan_in, or all through one ring they
+ *  claim slots of with a shared_write_cursor.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** @return events per second, or 0 if the consumer did not see every event */
+double fan_in_rings( uint32_t producers, int64_t per_producer )
+{
+   std::vector<std::shared_ptr<ring_buffer<int64_t,SIZE>>> buffers;
+   std::vector<write_cursor_ptr>                           writers;
+   fan_in in;
+   for( uint32_t i = 0; i < producers; ++i )
+   {
+      auto w = std::make_shared<write_cursor>("write",SIZE);
+      auto r = std::make_shared<read_cursor>("read");
+      r->follows(w);
+      w->follows(r);
+      r->start_at(-1);
+      buffers.push_back( std::make_shared<ring_buffer<int64_t,SIZE>>() );
+      writers.push_back( w );
+      in.add( r, 64 );
+   }
+
+   auto pub_thread = [&]( uint32_t i ){
+      auto p   = writers[i];
+      auto pos = p->begin();
+      auto end = p->end();
+      for( int64_t n = 0; n < per_producer; ++n )
+      {
+         if( pos >= end )
+         {
+            end = p->wait_for(pos);
+         }
+         buffers[i]->at(pos) = n;
+         p->publish(pos);
+         ++pos;
+      }
+      p->set_eof();
+   };
+
+   int64_t sum = 0;
+   auto handle = [&]( uint32_t ring, int64_t begin, int64_t end ) -> int64_t
+   {
+      for( auto pos = begin; pos < end; ++pos )
+         sum += buffers[ring]->at(pos);
+      return end;
+   };
+
+   double start = now();
+   std::vector<std::thread> threads;
+   for( uint32_t i = 0; i < producers; ++i )
+      threads.push_back( std::thread( pub_thread, i ) );
+   try
+   {
+      while( true )
+         if( !in.poll( handle ) ) in.wait();
+   }
+   catch ( const eof& ){}
+   double elapsed = now() - start;
+   for( auto itr = threads.begin(); itr != threads.end(); ++itr )
+      itr->join();
+
+   if( sum != producers * (per_producer * (per_producer - 1) / 2) ) return 0;
+   return producers * per_producer / elapsed;
+}
+
+/** @return events per second, or 0 if the consumer did not see every event */
+double shared_ring( uint32_t producers, int64_t per_producer )
+{
+   auto buffer = std::make_shared<ring_buffer<int64_t,SIZE>>();
+   auto p      = std::make_shared<shared_write_cursor>("write",SIZE);
+   auto c      = std::make_shared<read_cursor>("read");
+   c->follows(p);
+   p->follows(c);
+   c->start_at(-1);
+
+   auto pub_thread = [&](){
+      for( int64_t n = 0; n < per_producer; ++n )
+      {
+         auto slot = p->claim(1);
+         buffer->at(slot) = n;
+         p->publish_after( slot, slot - 1 );
+      }
+   };
+
+   int64_t total = producers * per_producer;
+   int64_t sum   = 0;
+   double  start = now();
+   std::vector<std::thread> threads;
+   for( uint32_t i = 0; i < producers; ++i )
+      threads.push_back( std::thread( pub_thread ) );
+
+   auto pos = c->begin();
+   auto end = c->end();
+   while( pos < total )
+   {
+      if( pos == end )
+      {
+         c->publish(pos-1);
+         end = c->wait_for(end);
+      }
+      sum += buffer->at(pos);
+      ++pos;
+   }
+   c->publish(pos-1);
+   double elapsed = now() - start;
+   for( auto itr = threads.begin(); itr != threads.end(); ++itr )
+      itr->join();
+
+   if( sum != producers * (per_producer * (per_producer - 1) / 2) ) return 0;
+   return total / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t events = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 40;
+
+   std::cout.precision(15);
+   for( uint32_t producers = 1; producers <= 8; producers *= 2 )
+   {
+      std::cout << producers << "P-1C fan_in over SPSC rings: " << fan_in_rings( producers, events / producers ) << " ops/secs" << std::endl;
+      std::cout << producers << "P-1C shared_write_cursor:    " << shared_ring( producers, events / producers )  << " ops/secs" << std::endl;
+   }
+   return 0;
+}
@@ -0,0 +1,165 @@
+#include <fc/thread/strand.hpp>
+#include <fc/thread/thread_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ *  Thousands of strands on a few threads.
+ *
+ *  Chains of tasks hop from strand to strand, so most strands are idle
+ *  and every hop puts one back into the ready ring.  Then fibers await
+ *  results from other strands, so every call blocks the caller's fiber
+ *  and unblocks it from the thread that ran the other strand.  Last every
+ *  strand posts many rings of tasks to the first one, which posts as many
+ *  to itself, so posters keep finding its ring full and must block.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+struct bench
+{
+   bench( uint32_t n, uint32_t c, int64_t h )
+   :chains(c),hops_per_chain(h),counts(n,0),finished(0)
+   {
+      for( uint32_t i = 0; i < n; ++i )
+         strands.push_back( std::unique_ptr<fc::strand>( new fc::strand( "bench" ) ) );
+   }
+
+   uint32_t                                   chains;
+   int64_t                                    hops_per_chain;
+   std::vector<std::unique_ptr<fc::strand>>   strands;
+   /** counts[i] is only touched by strand i */
+   std::vector<int64_t>                       counts;
+   std::atomic<uint32_t>                      finished;
+
+   uint32_t next( uint32_t i )const { return uint32_t( (i * 2654435761u + 1) % strands.size() ); }
+
+   /** a task that runs on strand at and posts itself to the next one */
+   struct hop
+   {
+      bench*   b;
+      uint32_t at;
+      int64_t  left;
+
+      void operator()()
+      {
+         ++b->counts[at];
+         if( --left == 0 ) { ++b->finished; return; }
+         hop h = { b, b->next( at ), left };
+         b->strands[h.at]->post( h );
+      }
+   };
+
+   /** @return the tasks run on every strand, once they are idle */
+   int64_t total()const
+   {
+      int64_t sum = 0;
+      for( auto itr = counts.begin(); itr != counts.end(); ++itr ) sum += *itr;
+      return sum;
+   }
+
+   /** @return tasks per second, or 0 if not every hop ran once */
+   double post_chains()
+   {
+      finished = 0;
+      std::fill( counts.begin(), counts.end(), 0 );
+      double start = now();
+      for( uint32_t c = 0; c < chains; ++c )
+      {
+         hop h = { this, uint32_t( c * strands.size() / chains ), hops_per_chain };
+         strands[h.at]->post( h );
+      }
+      while( finished.load() < chains ) usleep( 1000 );
+      double elapsed = now() - start;
+      return total() == chains * hops_per_chain ? chains * hops_per_chain / elapsed : 0;
+   }
+
+   /** @return calls per second, or 0 if not every call ran once */
+   double await_chains()
+   {
+      finished = 0;
+      std::fill( counts.begin(), counts.end(), 0 );
+      double   start = now();
+      int64_t  calls = hops_per_chain / 4;
+      for( uint32_t c = 0; c < chains; ++c )
+      {
+         uint32_t first = uint32_t( c * strands.size() / chains );
+         strands[first]->post( [=]()
+         {
+            uint32_t at = first;
+            for( int64_t i = 0; i < calls; ++i )
+            {
+               at = next( at );
+               uint32_t target = at;
+               strands[target]->await( [=]() { return ++counts[target]; } );
+            }
+            ++finished;
+         });
+      }
+      while( finished.load() < chains ) usleep( 1000 );
+      double elapsed = now() - start;
+      return total() == chains * calls ? chains * calls / elapsed : 0;
+   }
+
+   /** @return tasks per second, or 0 if the first strand did not run them all */
+   double fan_in()
+   {
+      finished = 0;
+      counts[0] = 0;
+      double   start  = now();
+      int64_t  tasks  = hops_per_chain;
+      uint32_t posters = uint32_t( strands.size() );
+      for( uint32_t i = 0; i < posters; ++i )
+      {
+         strands[i]->post( [=]()
+         {
+            for( int64_t t = 0; t < tasks; ++t )
+               strands[0]->post( [=](){ ++counts[0]; } );
+            ++finished;
+         });
+      }
+      while( finished.load() < posters ) usleep( 1000 );
+      // the first strand starts its tasks in order and they do not block
+      std::atomic<bool> drained( false );
+      strands[0]->post( [&](){ drained = true; } );
+      while( !drained.load() ) usleep( 1000 );
+      return counts[0] == posters * tasks ? posters * tasks / (now() - start) : 0;
+   }
+};
+
+int main( int argc, char** argv )
+{
+   uint32_t strands = argc > 1 ? atoi( argv[1] ) : 1024;
+   uint32_t threads = argc > 2 ? atoi( argv[2] ) : 4;
+   int64_t  hops    = argc > 3 ? atoll( argv[3] ) : 200;
+
+   bench b( strands, strands / 4, hops );
+   fc::thread_pool::start( threads );
+
+   std::cout.precision(15);
+   bool wrong = false;
+   for( int i = 0; i < 2; ++i )
+   {
+      double posted  = b.post_chains();
+      std::cout << strands << " strands on " << threads << " threads, posted hops:   " << posted  << " tasks/sec\n";
+      double awaited = b.await_chains();
+      std::cout << strands << " strands on " << threads << " threads, awaited calls: " << awaited << " calls/sec\n";
+      double fan_in  = b.fan_in();
+      std::cout << strands << " strands on " << threads << " threads, fan in:        " << fan_in  << " tasks/sec\n";
+      wrong = wrong || posted == 0 || awaited == 0 || fan_in == 0;
+   }
+
+   fc::thread_pool::stop();
+   return wrong;
+}
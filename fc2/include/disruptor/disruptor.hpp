@@ -53,6 +53,13 @@ class sequence
           return tmp;
       }
 
+      /** sets value if the sequence is still expected, else loads it into expected */
+      bool compare_exchange( int64_t& expected, int64_t value )
+      {
+          return _sequence.compare_exchange_weak( expected, value, std::memory_order_acq_rel,
+                                                                   std::memory_order_acquire );
+      }
+
    private:
       std::atomic<int64_t> _sequence;
       volatile int64_t     _alert;
@@ -77,6 +84,8 @@ class event_cursor;
 class barrier 
 {
    public:
+      barrier():_last_min(-1){}
+
       void follows( std::shared_ptr<const event_cursor> e );
 
       /**
@@ -292,6 +301,13 @@ class read_cursor : public event_cursor
       {
           return _end = _barrier.get_min() + 1;
       }
+
+      /** moves a cursor that is not in use yet to just after pos */
+      void start_at( int64_t pos )
+      {
+          _begin = _end = pos + 1;
+          _cursor.store( pos );
+      }
 };
 
 typedef std::shared_ptr<read_cursor> read_cursor_ptr;
@@ -442,6 +458,22 @@ class shared_write_cursor : public write_cursor
            return pos - num_slots;
       }
 
+      /**
+       *  Like claim() but returns -1 instead of waiting when
+       *  the readers have not made room for num_slots.
+       */
+      int64_t try_claim( size_t num_slots )
+      {
+           int64_t cur = _claim_cursor.aquire();
+           do
+           {
+              // the room claim() would wait for
+              if( cur + int64_t(num_slots) > check_end() ) return -1;
+           }
+           while( !_claim_cursor.compare_exchange( cur, cur + num_slots ) );
+           return cur;
+      }
+
       /**
        *  This method will block until 'after_pos' is the 
        *  current pos, then it will set pos to 'pos'
@@ -450,7 +482,9 @@ class shared_write_cursor : public write_cursor
       {
          try {
             assert( pos > after_pos );
-             _barrier.wait_for(after_pos);
+            // claims are published in order, wait for the one before ours
+            for( int i = 0; _cursor.aquire() < after_pos; ++i )
+               if( i > 1000 ) usleep(0);
             publish( pos );
          }
          catch ( const eof& ) { _cursor.set_eof(); throw; }
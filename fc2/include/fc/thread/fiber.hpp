@@ -78,7 +78,8 @@ namespace fc
       bool done()const;
 
     private:
-      fc::fwd<detail::fiber_impl,184> my;
+      friend class detail::fiber_impl;
+      fc::fwd<detail::fiber_impl,200> my;
   };
 } // namespace fc
 
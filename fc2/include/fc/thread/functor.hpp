@@ -33,16 +33,17 @@ namespace fc
    class functor
    {
       public:
-        functor():run(nullptr),destruct(nullptr){}
+        functor():run(nullptr),destruct(nullptr),move_construct(nullptr){}
         
         template<typename Functor>
         functor( Functor&& f )
         {
-           static_assert( sizeof(_buffer) >= sizeof(Functor), "insufficient space for functor" );
-           new (_buffer) Functor( std::forward<Functor>(f) );
-           run            = &detail::functor_invoker<Functor>::run;
-           destruct       = &detail::functor_invoker<Functor>::destruct;
-           move_construct = &detail::functor_invoker<Functor>::move_construct;
+           typedef typename fc::deduce<Functor>::type F;
+           static_assert( sizeof(_buffer) >= sizeof(F), "insufficient space for functor" );
+           new (_buffer) F( fc::forward<Functor>(f) );
+           run            = &detail::functor_invoker<F>::run;
+           destruct       = &detail::functor_invoker<F>::destruct;
+           move_construct = &detail::functor_invoker<F>::move_construct;
         }
         
         ~functor()
@@ -53,25 +54,25 @@ namespace fc
         functor( functor&& f )
         :run(f.run),destruct(f.destruct),move_construct(f.move_construct)
         {
-           f.destruct = nullptr;
            if( destruct != nullptr )
            {
               move_construct( f._buffer, _buffer );
+              destruct( f._buffer );
            }
+           f.destruct = nullptr;
         }
         
         template<typename Functor>
         functor& operator=( Functor&& f )
         {
-           static_assert( sizeof(_buffer) >= sizeof(Functor), "insufficient space for functor" );
-           if( this != &f )
-           {
-               if( destruct ) destruct(_buffer);
-               new (_buffer) Functor( std::forward<Functor>(f) );
-               run = &detail::functor_invoker<Functor>::run;
-               destruct = &detail::functor_invoker<Functor>::destruct;
-               move_construct = &detail::functor_invoker<Functor>::move_construct;
-           }
+           typedef typename fc::deduce<Functor>::type F;
+           static_assert( sizeof(_buffer) >= sizeof(F), "insufficient space for functor" );
+           // a functor is assigned by the overloads below, so f is never *this
+           if( destruct ) destruct(_buffer);
+           new (_buffer) F( fc::forward<Functor>(f) );
+           run = &detail::functor_invoker<F>::run;
+           destruct = &detail::functor_invoker<F>::destruct;
+           move_construct = &detail::functor_invoker<F>::move_construct;
            return *this;
         }
         functor& operator=( const functor& f )
@@ -82,9 +83,10 @@ namespace fc
         functor& operator=( functor&& f )
         {
           if( destruct ) destruct(_buffer);
-          if( f.move_construct )
+          if( f.destruct )
           {
             f.move_construct(f._buffer, _buffer);
+            f.destruct(f._buffer);
             move_construct = f.move_construct;
             destruct       = f.destruct;
             run            = f.run;
@@ -29,7 +29,7 @@ class basic_promise
     void _wait();
 
   private:
-    fwd<detail::promise_impl,64> my;
+    fwd<detail::promise_impl,72> my;
 };
 
 template<typename T>
@@ -43,7 +43,7 @@ class promise : public basic_promise
     T& wait()
     { 
       _wait();
-      return std::move(*_result);
+      return *_result;
     }
 
     template<typename V>
@@ -21,7 +21,7 @@
 class onetime_spin_lock
 {
    public:
-      onetime_spin_lock();
+      onetime_spin_lock():_state(0){}
       bool try_lock() 
       { 
          return ready() || 0 == _state.fetch_add(1); // lock + add 0 gives you the lock.
@@ -46,21 +46,26 @@ thread& get_current_thread();
  *    1) onetime lock on future publishing  add_fetch
  *    2) publish claim counter, hit every time a strand is published add_fetch
  *    3) execute claim counter, hit every time a strand yields. add_fetch
- *    4) sleep thread claim publishing add_fetch
+ *    4) the scheduled flag of a strand, exchanged when an idle strand is
+ *       posted to or unblocked.
  *
  *  Where are the locks:
- *    1) when there are no ready strands, a thread will lock a mutex
- *        and increment a 'wait counter', then check the published
- *        index one last time before sleeping.
+ *    1) a thread that has spun and yielded without its claimed slot being
+ *       published locks a mutex, increments a 'sleepers' counter, checks
+ *       the published index one last time and then waits to be notified.
  *
- *        On waking, wait counter will be decremented.
+ *       On waking, sleepers will be decremented.
  *
- *    2) On post, save wait counter,
- *       update publish pos
- *       if saved wait counter > 0, 
- *         ??? grab mutex ??? ... if this can be avoided it would help producers a lot..
- *       - notify all, 
+ *    2) A publisher updates the publish pos and, after a fence, reads
+ *       sleepers and the execute claim counter.  Only if a thread sleeps
+ *       and has claimed the slot just published, claimed > published
+ *       before the publish, does it grab the mutex and notify all, so 
+ *       producers never touch the mutex while the threads are busy.
  *
+ *  A strand is scheduled while it is in the ring or being run.  Posting and
+ *  unblocking publish first and then, after a fence, check the flag.  When
+ *  run() is done it clears the flag and, after a fence, checks for work 
+ *  once more, so either the poster or the strand itself re-enqueues it.
  *
  *  A publisher cannot publish to a slot
  *  until the executor has 'claimed it'. In practice all we need to do is
@@ -68,7 +73,13 @@ thread& get_current_thread();
  *  until it is ready.... producers would then track how many total have
  *  been consumed to catch 'wrapping'... but wrapping should never be a problem, 
  *  assuming we have an upper limit of total 'strands' as each 'strand' has
- *  its own 'fixed size' ring buffer they are not cheap.
+ *  its own 'fixed size' ring buffer they are not cheap.  That limit is 
+ *  thread_pool::max_strands.
+ *
+ *  A fiber that posts to a strand whose ring is full blocks until that
+ *  strand has run a turn, so it waits without holding its thread, even
+ *  when it posts to its own strand.  Threads that are not running a
+ *  strand wait in the post, so they must not be threads of the pool.
  */
 class strand
 {
@@ -101,7 +112,10 @@ class strand
 
      /**
       * Processes tasks on this strand until everything
-      * is 'blocked'.
+      * is 'blocked' or it has run for a turn, after which
+      * the strand goes to the back of the ready ring if it
+      * still has work.  Called by the threads of the 
+      * thread_pool for the strands they claim.
       *
       * @return true if *something* was run, false if there was nothing to do
       */
@@ -121,6 +135,7 @@ class strand
 
   private:
      friend class basic_promise;
+     friend class detail::strand_impl;
      void block( context& f, const char* desc = "");
      void unblock( context& f );
      void notify();
@@ -168,11 +183,11 @@ auto strand::await( Functor&& f, const char* desc  ) -> decltype(f())
     typedef decltype(f()) Result;
     optional<Result>      _result;
     std::exception_ptr    _except;
-    context&              _current_ctx = context::current();
+    // the calling fiber and its strand, which may not be *this
+    context               _caller = context::current();
+    assert( _caller._strand && "only the fibers of a strand can await" );
 
-    block( _current_ctx, desc );
-     
-    // capture by reference
+    // capture by reference, the caller is blocked until f has run
     post( [&](){
        try 
        {
@@ -182,10 +197,13 @@ auto strand::await( Functor&& f, const char* desc  ) -> decltype(f())
        {
           _except = std::current_exception();
        }
-       _current_ctx._strand->unblock( _current_ctx );
+       _caller._strand->unblock( _caller );
     });
 
-    yield();
+    // after the post, which may block while the ring is full, f may already
+    // have unblocked the caller, the strand resumes it after this yield
+    _caller._strand->block( _caller, desc );
+    _caller._strand->yield();
 
     if( _except != std::exception_ptr() ) 
        std::rethrow_exception(_except);
@@ -0,0 +1,60 @@
+#pragma once
+#include <memory>
+#include <stdint.h>
+
+namespace fc 
+{
+class strand;
+
+namespace detail
+{
+  class thread_pool_impl;
+  class strand_impl;
+}
+
+/**
+ *  Manages a set of threads to process strands.
+ *
+ *  A strand with work is published to the global ring of ready strands, 
+ *  each thread claims the next slot of the ring, runs the strand it finds
+ *  there for a turn and claims another.  A thread spins, then yields and 
+ *  only sleeps once the slot it claimed has still not been published, see
+ *  strand for the details.
+ */
+class thread_pool
+{
+   public:
+     /** 
+      *  The size of the ready ring.  A strand is in the ready ring at most
+      *  once, so while no more strands exist at once pushes never wait.
+      *  A thread that claimed a slot but has yet to read it still holds 
+      *  it, the push a lap later waits for it.
+      */
+     enum { max_strands = 1 << 16 };
+
+     ~thread_pool();
+
+     /** starts num_threads threads that run ready strands */
+     static void start( uint32_t num_threads = 8 );
+
+     /**
+      *  Stops the threads once the strands they are running have had 
+      *  their turn and waits for them to exit.  Strands still in the 
+      *  ready ring are not run and the pool cannot be started again.
+      */
+     static void stop();
+
+     static thread_pool& instance();
+
+   private: 
+     friend class detail::strand_impl;
+     thread_pool();
+
+     /** publishes s, which must not be in the ring already, to the ready ring */
+     void schedule( strand* s );
+
+     std::unique_ptr<detail::thread_pool_impl> my;
+};
+
+
+} // namespace fc
@@ -1,51 +1,86 @@
-#include <boost/context/all.hpp>
-#include <boost/coroutine/stack_allocator.hpp>
+#include <boost/context/detail/fcontext.hpp>
+#include <boost/context/fixedsize_stack.hpp>
 #include <fc/thread/fiber.hpp>
 #include <fc/fwd_impl.hpp>
+#include <exception>
 
 namespace fc
 {
   namespace bc  = boost::context;
-  namespace bco = boost::coroutines;
   namespace detail
   {
+     /**
+      *  Passed with every switch, the receiver records where from stopped
+      *  because a suspended fcontext is only known to whoever resumes it.
+      */
+     struct jump
+     {
+        fiber* from;
+        fiber* to;
+     };
+
      class fiber_impl
      {
        public:
         fiber_impl()
         :_context(nullptr),
-         _caller(nullptr)
+         _caller(nullptr),
+         _done(false)
+        {
+        }
+
+        /** where to resume the fiber, only valid while it is suspended */
+        bc::detail::fcontext_t  _context;
+        bc::stack_context       _stack;
+        fiber*                  _caller;
+        functor<>               _functor;
+        std::exception_ptr      _exit_except;
+        bool                    _done;
+
+        static void record( bc::detail::transfer_t t )
+        {
+           jump* j = static_cast<jump*>(t.data);
+           (*j->from->my)._context = t.fctx;
+        }
+
+        /**
+         *  Suspends from and runs to, returns once something switches back
+         *  to from, which may be on another thread.
+         */
+        static void switch_to( fiber& from, fiber& to )
         {
+           context::current()._fiber = &to;
+           jump j = { &from, &to };
+           record( bc::detail::jump_fcontext( (*to.my)._context, &j ) );
         }
 
-        bc::fcontext_t*    _context;
-        fiber*             _caller;
-        functor<>          _functor;
-        std::exception_ptr _exit_except;
-        bool               _done;
-      
-        static void start( intptr_t s )
+        static void start( bc::detail::transfer_t t )
         {
-           fiber_impl* self = reinterpret_cast<fiber_impl*>(s);
+           record( t );
+           fiber&      self = *static_cast<jump*>(t.data)->to;
+           fiber_impl& impl = *self.my;
            try {
-             self->_functor.call();
-           } 
+             impl._functor.call();
+           }
            catch ( ... )
            {
-             self->_exit_except = std::current_exception();
+             impl._exit_except = std::current_exception();
            }
-           self->_done  = true;
-           assert( self->_caller );
-           reinterpret_cast<fiber*>(self)->yield_to(*self->_caller);
+           impl._done  = true;
+           assert( impl._caller );
+           switch_to( self, *impl._caller );
         }
      };
   }
 
   bool fiber::done()const { return my->_done; }
-  context& context::current()
+
+  // never inlined, a fiber may resume on another thread and must not
+  // keep using the thread local it saw before it was suspended
+  __attribute__((noinline)) context& context::current()
   {
       #ifdef _MSC_VER
-         static __declspec(context) context* t = NULL;
+         static __declspec(thread) context* t = NULL;
       #else
          static __thread context* t = NULL;
       #endif
@@ -53,27 +88,27 @@ namespace fc
       return *t;
   }
 
-  bco::stack_allocator& get_stack_alloc()
+  bc::fixedsize_stack& get_stack_alloc()
   {
-    static bco::stack_allocator self;
+    static bc::fixedsize_stack self;
     return self;
   }
 
+  /** the fiber of a thread's own stack, its context is set when it first switches away */
   fiber::fiber()
   {
-      my->_context = new bc::fcontext_t();
   }
 
   fiber::~fiber()
   {
-      get_stack_alloc().deallocate( my->_context->fc_stack.sp, my->_context->fc_stack.size );
-      // TODO:... if I allocated _context... delete it...
+      if( my->_stack.sp ) get_stack_alloc().deallocate( my->_stack );
   }
 
   fiber::fiber( functor<> start, size_t stack_size  )
   {
       my->_functor = std::move(start);
-      my->_context = bc::make_fcontext(get_stack_alloc().allocate(stack_size), stack_size, &detail::fiber_impl::start);
+      my->_stack   = bc::fixedsize_stack( stack_size ).allocate();
+      my->_context = bc::detail::make_fcontext( my->_stack.sp, my->_stack.size, &detail::fiber_impl::start );
   }
 
   /** return true if the fiber is 'complete' or throw an exception
@@ -81,19 +116,7 @@ namespace fc
    */
   bool fiber::start()
   {
-    assert( !done() );
-    context& cur = context::current();
-    if( !cur._fiber ) 
-      cur._fiber = new fiber();
-
-    my->_caller = cur._fiber;
-    cur._fiber = this;
-    auto r = bc::jump_fcontext( my->_caller->my->_context, my->_context, (intptr_t)&my );
-    context* c = reinterpret_cast<context*>(r);
-    // I may have woken up in a new thread...
-    assert( c == &context::current() );
-    if( my->_exit_except ) std::rethrow_exception( my->_exit_except );
-    return my->_done;
+    return resume();
   }
 
   /**
@@ -103,14 +126,8 @@ namespace fc
   bool fiber::resume()
   {
     assert( !done() );
-    context& cur = context::current();
-    if( !cur._fiber ) cur._fiber = new fiber();
     my->_caller = &fiber::current();
-    cur._fiber = this;
-    auto r = bc::jump_fcontext( my->_caller->my->_context, my->_context, (intptr_t)&cur );
-    context* c = reinterpret_cast<context*>(r);
-    // I may have woken up in a new thread...
-    assert( c == &context::current() );
+    detail::fiber_impl::switch_to( *my->_caller, *this );
 
     if( my->_exit_except ) std::rethrow_exception( my->_exit_except );
     return my->_done;
@@ -125,31 +142,25 @@ namespace fc
   }
 
   /**
-   *  Jumps to another fiber.  This can only be called 
+   *  Jumps to another fiber.  This can only be called
    *  from the current fiber.
    */
   bool fiber::yield_to( fiber& f  )
   {
     assert( &f != this );
-    context& cur = context::current();
-    assert( cur._fiber == this );
+    assert( context::current()._fiber == this );
 
     // don't set caller for yield to... because someone who called
     // this fiber via 'start' or 'resume' depend upon having control
     // returned to them when the fiber exits.
-    // my->caller = cur._fiber; 
-    auto from = this;
-    cur._fiber = &f; // we are jumping to this... 
-    auto r = bc::jump_fcontext( from->my->_context, f.my->_context, (intptr_t)&cur );
-    context* c = reinterpret_cast<context*>(r);
-    assert( c == &context::current() );
+    detail::fiber_impl::switch_to( *this, f );
 
     if( my->_exit_except ) std::rethrow_exception( my->_exit_except );
     return my->_done;
   }
 
-  /** 
-   * Shorthand for yield_to( *caller() ) 
+  /**
+   * Shorthand for yield_to( *caller() )
    */
   void fiber::yield()
   {
@@ -161,14 +172,14 @@ namespace fc
    */
   fiber& fiber::current()
   {
-    auto cc = context::current();
+    context& cc = context::current();
     if( !cc._fiber ) cc._fiber = new fiber();
     return *cc._fiber;
   }
 
   size_t fiber::default_stack_size()
   {
-     return bco::stack_allocator::default_stacksize();
+     return bc::stack_traits::default_size();
   }
 
 } // namespace fc
@@ -13,7 +13,9 @@ namespace detail {
     class promise_impl
     {
       public:
+      promise_impl():_notified(false){}
       onetime_spin_lock    _lock;
+      bool                 _notified;
       std::exception_ptr   _except;
       const char*          _what;
       context              _blocked_context;
@@ -23,9 +25,14 @@ basic_promise::basic_promise( const char* w )
 { my->_what = w; } 
 basic_promise::~basic_promise(){}
 
+/**
+ *  Whichever of _notify() and _wait() takes the lock first decides 
+ *  whether the waiter blocks, the other one sees what it did.
+ */
 void basic_promise::_notify()
 {
   { synchronized( my->_lock )
+    my->_notified = true;
     if( my->_blocked_context._fiber != nullptr )
     {
          my->_blocked_context._strand->unblock( my->_blocked_context );
@@ -37,20 +44,30 @@ const char* basic_promise::what()const { return my->_what; }
 
 void basic_promise::_wait()
 {
-   if( my->_lock.ready() ) return;
+   if( !my->_lock.ready() ) 
+   {
+      // only one strand can block on a promise
+      // to allow more than one strand would increase locking requirements and
+      // greatly slow down the most common case.... to implement multiple
+      // waiters, pick one strand to wait and then 'notify' everyone else.
+      assert( my->_blocked_context._strand == nullptr ); 
 
-   // only one strand can block on a promise
-   // to allow more than one strand would increase locking requirements and
-   // greatly slow down the most common case.... to implement multiple
-   // waiters, pick one strand to wait and then 'notify' everyone else.
-   assert( my->_blocked_context._strand == nullptr ); 
+      strand* s = context::current()._strand;
+      assert( s && "only the fibers of a strand can wait" );
 
-   my->_blocked_context  = context::current();
-
-   { synchronized( my->_lock )
-       if( my->_lock.ready() ) return;
-       my->_blocked_context._strand->block( my->_blocked_context, what() );  
+      bool blocked = false;
+      { synchronized( my->_lock )
+          if( !my->_notified )
+          {
+             my->_blocked_context = context::current();
+             s->block( my->_blocked_context, what() );  
+             blocked = true;
+          }
+      }
+      // until _notify() unblocks this fiber
+      if( blocked ) s->yield();
    }
+   if( my->_except ) std::rethrow_exception( my->_except );
 }
 
 void basic_promise::set_exception( std::exception_ptr e )
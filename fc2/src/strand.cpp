@@ -1,108 +1,292 @@
 #include <fc/thread/strand.hpp>
 #include <fc/thread/thread_pool.hpp>
-#include <fc/disruptor/cursor.hpp>
-#include <fc/disruptor/ring_buffer.hpp>
-#include <dequeue>
+#include <disruptor/disruptor.hpp>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
 
-#include <boost/context/all.hpp>
-#include <boost/coroutine/stack_allocator.hpp>
+namespace fc {
 
 namespace detail
 {
-  namespace bc  = boost::context;
-  namespace bco = boost::coroutines;
   using namespace disruptor;
 
+  /** how many strands exist, at most thread_pool::max_strands */
+  static std::atomic<uint32_t> strand_count( 0 );
+
   class strand_impl
   {
      public:
-       strand*                            _self;
-       fiber*                             _cur_fiber;
-       fiber*                             _run_loop;
+       /** how many tasks or fiber switches a strand runs before it lets another strand have the thread */
+       enum { run_budget = 64 };
+
+       strand_impl( strand* s, const char* n )
+       :_self(s),
+        _name(n),
+        _post_cursor( std::make_shared<shared_write_cursor>( "post", 128 ) ),
+        _read_cursor( std::make_shared<read_cursor>( "run" ) ),
+        _unblock_cursor( std::make_shared<shared_write_cursor>( "unblock", 128 ) ),
+        _read_unblock_cursor( std::make_shared<read_cursor>( "resume" ) ),
+        _blocking(false),
+        _budget(0),
+        _scheduled(false),
+        _room_waiter_count(0)
+       {
+          _read_cursor->follows( _post_cursor );
+          _post_cursor->follows( _read_cursor );
+          _read_unblock_cursor->follows( _unblock_cursor );
+          _unblock_cursor->follows( _read_unblock_cursor );
+          // nothing is read yet, so pos() compares with what was published
+          _read_cursor->start_at( -1 );
+          _read_unblock_cursor->start_at( -1 );
+       }
+
+       strand*                              _self;
+       const char*                          _name;
+
+       ring_buffer< functor<104>, 128 >     _post_buffer;
+       shared_write_cursor_ptr              _post_cursor;
+       read_cursor_ptr                      _read_cursor;
+
+       /** fibers unblocked by any thread, resumed by the strand */
+       ring_buffer< fiber*, 128 >           _unblock_buffer;
+       shared_write_cursor_ptr              _unblock_cursor;
+       read_cursor_ptr                      _read_unblock_cursor;
+
+       /** fibers that were unblocked or yielded, run ahead of new tasks */
+       std::deque<fiber*>                   _ready_fibers;
+       /** fibers that ran out of tasks and wait for the next one */
+       std::vector<fiber*>                  _idle_fibers;
+       std::vector<std::unique_ptr<fiber>>  _fibers;
+
+       /** set by block() so that the next yield() does not make the fiber ready */
+       bool                                 _blocking;
+       int32_t                              _budget;
+
+       /** true while the strand is in the ready ring or being run */
+       std::atomic<bool>                    _scheduled;
+
+       /** fibers of any strand waiting in strand::claim() for room in the post ring */
+       std::mutex                           _room_mutex;
+       std::deque<context>                  _room_waiters;
+       std::atomic<uint32_t>                _room_waiter_count;
+
+       bool has_task()
+       {
+          return _read_cursor->begin() < _read_cursor->end() ||
+                 _read_cursor->begin() < _read_cursor->check_end();
+       }
+
+       bool has_work()
+       {
+          return _ready_fibers.size() || has_task() ||
+                 _read_unblock_cursor->begin() < _read_unblock_cursor->check_end();
+       }
 
-       const char*                        _name;
-       ring_buffer< functor<104>, 128 >   _post_buffer;
-       shared_write_cursor                _write_cursor;
-       read_cursor                        _read_cusror;
-       std::dequeue<fiber*>               _ready_fibers;
+       /** only reads the sequences, safe once another thread may own the strand */
+       bool has_posted()const
+       {
+          return _read_cursor->pos().aquire() < _post_cursor->pos().aquire() ||
+                 _read_unblock_cursor->pos().aquire() < _unblock_cursor->pos().aquire();
+       }
 
-       bco::stack_allocator               _stack_alloc;
+       /**
+        *  Unblocks the first fibers waiting for room, one for each task read,
+        *  they claim again when resumed.  Any left wait for the tasks posted
+        *  by those, which the strand has to read first.
+        */
+       void wake_room_waiters( int64_t read )
+       {
+          std::vector<context> waiters;
+          {
+             std::unique_lock<std::mutex> lock( _room_mutex );
+             while( _room_waiters.size() && int64_t(waiters.size()) < read )
+             {
+                waiters.push_back( _room_waiters.front() );
+                _room_waiters.pop_front();
+             }
+             _room_waiter_count.store( uint32_t( _room_waiters.size() ) );
+          }
+          for( auto itr = waiters.begin(); itr != waiters.end(); ++itr )
+             itr->_strand->unblock( *itr );
+       }
 
-       strand_impl( const char* n )
-       :_name(n),_write_cursor(128)
+       /** moves the fibers unblocked since the last call to the ready list */
+       void take_unblocked()
        {
-          _read_cursor->follows( *_write_cursor );
-          _write_cursor->follows( *_read_cursor );
+          int64_t pos = _read_unblock_cursor->begin();
+          int64_t end = _read_unblock_cursor->check_end();
+          if( pos >= end ) return;
+          for( ; pos < end; ++pos )
+             _ready_fibers.push_back( _unblock_buffer.at(pos) );
+          _read_unblock_cursor->publish( end - 1 );
        }
 
-       fiber* current_fiber()
+       void schedule()
        {
-          if( !_cur_fiber ) 
-             return _cur_fiber = new fiber();
-          return _cur_fiber;
+          if( !_scheduled.exchange( true ) )
+             thread_pool::instance().schedule( _self );
        }
 
        /**
-        *  
+        *  The body of every fiber of the strand, runs posted tasks and
+        *  returns control to run() when it blocks, has used the strand's
+        *  turn or there are no tasks left.
         */
-       void yield()
+       void run_tasks()
+       {
+          fiber& self = fiber::current();
+          while( true )
+          {
+             while( has_task() )
+             {
+                // the slot is released before the task runs, it may block
+                int64_t      pos = _read_cursor->begin();
+                functor<104> task( std::move( _post_buffer.at(pos) ) );
+                _read_cursor->publish( pos );
+                try
+                {
+                   task.call();
+                }
+                catch ( ... )
+                {
+                   // nobody to report to, async() reports through its promise
+                }
+                if( --_budget <= 0 )
+                {
+                   _ready_fibers.push_front( &self );
+                   self.yield();
+                }
+             }
+             _idle_fibers.push_back( &self );
+             self.yield();
+          }
+       }
+
+       bool run()
        {
-           process_unblock_ring(); // move these to front of ready queue
-           process_timeout(); // timeouts are even higher priority than unblocked
-
-           if( _ready_fibers.size() )
-           {
-              auto next = _ready_fibers.front();
-              _ready_fibers.pop_front();
-              next->resume();
-              thread& cur_thread = 
-              thread::set_current_fiber( _cur_fiber );
-              thread::set_current_strand( _self );
-              return;
-           }
-           else if( read_cursor.begin() < read_cursor.end() ||
-                    read_cursor.begin() < read_cursor.check_end() )
-           {
-              fiber* f = new fiber( &strand_impl::start_fiber, _stack_alloc, this );
-              f->start();
-              thread::set_current_fiber( _cur_fiber );
-              thread::set_current_strand( _self );
-              return;
-           }
-           else
-           {
-              _run_loop->resume();
-           }
+          context& ctx    = context::current();
+          strand*  caller = ctx._strand;
+          ctx._strand     = _self;
+          _budget         = run_budget;
+          int64_t  first  = _read_cursor->begin();
+
+          bool ran = false;
+          while( _budget > 0 )
+          {
+             take_unblocked();
+
+             fiber* next = nullptr;
+             if( _ready_fibers.size() )
+             {
+                next = _ready_fibers.front();
+                _ready_fibers.pop_front();
+             }
+             else if( has_task() )
+             {
+                if( _idle_fibers.size() )
+                {
+                   next = _idle_fibers.back();
+                   _idle_fibers.pop_back();
+                }
+                else
+                {
+                   _fibers.push_back( std::unique_ptr<fiber>( new fiber( [this](){ run_tasks(); } ) ) );
+                   next = _fibers.back().get();
+                }
+             }
+             else break;
+
+             ran = true;
+             --_budget;
+             next->resume();
+          }
+          ctx._strand = caller;
+
+          // pairs with the fence in strand::claim(), either a fiber waiting
+          // for room sees the tasks read this turn or we see it waiting
+          std::atomic_thread_fence( std::memory_order_seq_cst );
+          if( _room_waiter_count.load( std::memory_order_relaxed ) )
+             wake_room_waiters( _read_cursor->begin() - first );
+
+          // the strand is still ours, so it goes straight back in the ring
+          if( has_work() )
+          {
+             thread_pool::instance().schedule( _self );
+             return ran;
+          }
+
+          // pairs with the fence in strand::notify(), either the poster
+          // sees that the strand is no longer scheduled or we see its work.
+          // Another thread may own the strand once the flag is clear, so
+          // only the sequences are read after it.
+          _scheduled.store( false );
+          std::atomic_thread_fence( std::memory_order_seq_cst );
+          if( has_posted() ) schedule();
+          return ran;
        }
   };
 }
 
 
-strand::strand( const char* name = "" )
-:my( new detail::strand_impl(name) )
+strand::strand( const char* name )
+:my( new detail::strand_impl( this, name ) )
 {
+   uint32_t count = ++detail::strand_count;
+   assert( count <= thread_pool::max_strands );
+   (void)count;
 }
 
+/** the fibers of the strand must all be idle */
 strand::~strand()
 {
-   // clean up _post_buffer
-   // clean up _ready_fibers
+   assert( !my->_scheduled.load() && "a strand cannot be destroyed while it is scheduled" );
+   --detail::strand_count;
 }
 
-/**
- *  Runs tasks until there is nothing left to do.
- */
-void strand::run()
+bool strand::run()
 {
-
+   return my->run();
 }
 
+/**
+ *  A fiber that finds the ring full blocks until the strand has read
+ *  tasks, so that its thread is free to run the strand meanwhile.  Any
+ *  other caller is not one of the pool's threads and waits in claim().
+ */
 int64_t strand::claim()
 {
-   return my->_post_cursor->claim(1);
+   int64_t slot = my->_post_cursor->try_claim(1);
+   if( slot >= 0 ) return slot;
+
+   // a copy, the fiber may resume on another thread
+   context caller = context::current();
+   if( !caller._strand ) return my->_post_cursor->claim(1);
+
+   while( true )
+   {
+      {
+         std::unique_lock<std::mutex> lock( my->_room_mutex );
+         my->_room_waiters.push_back( caller );
+         ++my->_room_waiter_count;
+         // pairs with the fence in strand_impl::run()
+         std::atomic_thread_fence( std::memory_order_seq_cst );
+         slot = my->_post_cursor->try_claim(1);
+         if( slot >= 0 )
+         {
+            my->_room_waiters.pop_back();
+            --my->_room_waiter_count;
+            return slot;
+         }
+         caller._strand->block( caller, "waiting for room to post" );
+      }
+      caller._strand->yield();
+      if( (slot = my->_post_cursor->try_claim(1)) >= 0 ) return slot;
+   }
 }
 
-functor& strand::slot( int64_t slot )
+functor<104>& strand::get_slot( int64_t slot )
 {
    return my->_post_buffer.at(slot);
 }
@@ -112,9 +296,31 @@ void strand::publish( int64_t slot )
     my->_post_cursor->publish_after( slot, slot - 1 );
 }
 
+void strand::block( context& f, const char* desc )
+{
+   assert( f._strand == this && f._fiber == &fiber::current() );
+   f._block_desc = desc;
+   my->_blocking = true;
+}
+
+void strand::unblock( context& f )
+{
+   int64_t slot = my->_unblock_cursor->claim(1);
+   my->_unblock_buffer.at(slot) = f._fiber;
+   my->_unblock_cursor->publish_after( slot, slot - 1 );
+   notify();
+}
+
+/**
+ *  Gives up the thread, a blocked fiber until it is unblocked and any
+ *  other until the strand has run the fibers that are ready before it.
+ */
 void strand::yield()
 {
-   my->yield();
+   fiber& cur = fiber::current();
+   if( my->_blocking ) my->_blocking = false;
+   else                my->_ready_fibers.push_back( &cur );
+   cur.yield();
 }
 
 void strand::notify()
@@ -122,4 +328,9 @@ void strand::notify()
    // if this strand is 'idle' then it needs to be put
    // into the thread pool queue for execution asap
    // if it is active then nothing to do here...
+   std::atomic_thread_fence( std::memory_order_seq_cst );
+   if( !my->_scheduled.load( std::memory_order_relaxed ) )
+      my->schedule();
 }
+
+} // namespace fc
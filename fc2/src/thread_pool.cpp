@@ -0,0 +1,149 @@
+#include <fc/thread/thread_pool.hpp>
+#include <fc/thread/strand.hpp>
+#include <disruptor/disruptor.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <vector>
+
+namespace fc {
+
+namespace detail
+{
+  using disruptor::sequence;
+
+  class thread_pool_impl
+  {
+     public:
+       thread_pool_impl()
+       :_write_claim(-1),_published(-1),_read_claim(-1),_sleepers(0),_done(false)
+       {
+          for( uint32_t i = 0; i < thread_pool::max_strands; ++i ) 
+          {
+             _ready[i].turn.store( i, std::memory_order_relaxed );
+             _ready[i].ready = nullptr;
+          }
+       }
+
+       struct ready_slot
+       {
+          /** the claim that may write this slot next, set by the thread that read the last one */
+          std::atomic<int64_t> turn;
+          strand*              ready;
+       };
+
+       /** the last slot claimed by a strand that became ready */
+       sequence                                      _write_claim;
+       /** slots up to here hold a strand, published in the order they were claimed */
+       sequence                                      _published;
+       /** the last slot claimed by a thread */
+       sequence                                      _read_claim;
+       ready_slot                                    _ready[thread_pool::max_strands];
+
+       /** threads waiting on _wake for their claimed slot to be published */
+       std::atomic<uint32_t>                         _sleepers;
+       boost::mutex                                  _mutex;
+       boost::condition_variable                     _wake;
+       std::atomic<bool>                             _done;
+
+       std::vector<std::unique_ptr<boost::thread>>   _threads;
+
+       void push( strand* s )
+       {
+          int64_t slot = _write_claim.atomic_increment_and_get(1);
+          auto&   r    = _ready[slot & (thread_pool::max_strands-1)];
+
+          // the thread that claimed this slot a lap ago may not have read it yet
+          for( int i = 0; r.turn.load( std::memory_order_acquire ) != slot; ++i )
+             if( i > 1000 ) boost::this_thread::yield();
+          r.ready = s;
+
+          // claims are published in order, wait for the one before ours
+          for( int i = 0; _published.aquire() < slot - 1; ++i )
+             if( i > 1000 ) boost::this_thread::yield();
+          _published.store( slot );
+
+          // pairs with the fence in pop(), either the thread that claimed
+          // this slot sees it published or we see that it sleeps
+          std::atomic_thread_fence( std::memory_order_seq_cst );
+          if( _sleepers.load( std::memory_order_relaxed ) && _read_claim.aquire() >= slot )
+          {
+             boost::unique_lock<boost::mutex> lock( _mutex );
+             _wake.notify_all();
+          }
+       }
+
+       /** @return the strand in the next slot, waiting for it to be published, or nullptr once stopped */
+       strand* pop()
+       {
+          int64_t slot = _read_claim.atomic_increment_and_get(1);
+
+          // like the barrier, spin and then yield before sleeping
+          for( int i = 0; _published.aquire() < slot && i < 2000; ++i )
+             if( i > 1000 ) boost::this_thread::yield();
+
+          if( _published.aquire() < slot )
+          {
+             boost::unique_lock<boost::mutex> lock( _mutex );
+             ++_sleepers;
+             std::atomic_thread_fence( std::memory_order_seq_cst );
+             while( _published.aquire() < slot && !_done.load() )
+                _wake.wait( lock );
+             --_sleepers;
+             if( _published.aquire() < slot ) return nullptr;
+          }
+          auto&   r = _ready[slot & (thread_pool::max_strands-1)];
+          strand* s = r.ready;
+          r.turn.store( slot + thread_pool::max_strands, std::memory_order_release );
+          return s;
+       }
+
+       void work()
+       {
+          while( strand* s = pop() )
+             s->run();
+       }
+  };
+}
+
+thread_pool::thread_pool()
+:my( new detail::thread_pool_impl() )
+{
+}
+
+thread_pool::~thread_pool()
+{
+}
+
+thread_pool& thread_pool::instance()
+{
+   static thread_pool self;
+   return self;
+}
+
+void thread_pool::start( uint32_t num_threads )
+{
+   detail::thread_pool_impl* p = instance().my.get();
+   assert( !p->_done && "the pool cannot be started again" );
+   for( uint32_t i = 0; i < num_threads; ++i )
+      p->_threads.push_back( std::unique_ptr<boost::thread>( new boost::thread( [=]() { p->work(); } ) ) );
+}
+
+void thread_pool::stop()
+{
+   detail::thread_pool_impl* p = instance().my.get();
+   {
+      boost::unique_lock<boost::mutex> lock( p->_mutex );
+      p->_done = true;
+      p->_wake.notify_all();
+   }
+   for( auto itr = p->_threads.begin(); itr != p->_threads.end(); ++itr )
+      (*itr)->join();
+   p->_threads.clear();
+}
+
+void thread_pool::schedule( strand* s )
+{
+   my->push( s );
+}
+
+} // namespace fc
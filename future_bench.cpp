@@ -0,0 +1,92 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <sys/time.h>
+
+/**
+ *  Round trips through thread::async, first waited on with get() and
+ *  then continued on another thread with then().  Every allocation in
+ *  the process is counted.  Once the futures' pool is warm get() round
+ *  trips should not allocate.  A continued state goes back to the pool
+ *  of whichever thread drops it last, so when that is the worker the
+ *  caller's pool is short one and the next async allocates.
+ */
+
+static std::atomic<int64_t> allocations(0);
+
+void* operator new( size_t n )
+{
+   ++allocations;
+   void* p = malloc( n );
+   if( !p ) throw std::bad_alloc();
+   return p;
+}
+void operator delete( void* p ) noexcept         { free( p ); }
+void operator delete( void* p, size_t ) noexcept { free( p ); }
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** prints round trips per second, or 0 if a result was wrong, and the allocations they made */
+void report( const char* label, int64_t trips, double elapsed, bool right, int64_t allocs )
+{
+   std::cout << label << (right ? trips / elapsed : 0) << " round trips/sec, "
+             << allocs << " allocations" << std::endl;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t trips = argc > 1 ? atoll( argv[1] ) : 1000L * 100;
+
+   disruptor::thread worker;
+   disruptor::thread caller;
+   worker.start();
+   caller.start();
+   std::cout.precision(15);
+
+   for( int i = 0; i < 2000; ++i ) worker.async( [=](){ return i; } ).get();
+   {
+      int64_t before = allocations;
+      int64_t sum    = 0;
+      double  start  = now();
+      for( int64_t i = 0; i < trips; ++i )
+         sum += worker.async( [=](){ return i; } ).get();
+      double elapsed = now() - start;
+      report( "async then get:  ", trips, elapsed, sum == trips * (trips - 1) / 2, allocations - before );
+   }
+
+   // the continuation runs on caller, which keeps the state's pool there
+   std::atomic<int64_t> sum(0), done(0);
+   auto continue_on_caller = [&]( int64_t n ){
+      sum  = 0;
+      done = 0;
+      for( int64_t i = 0; i < n; ++i )
+      {
+         // each side posts to the other, so keep both rings from filling
+         if( i % 128 == 0 ) while( done < i ) usleep(10);
+         caller.atomic_post( [&,i](){
+            worker.async( [=](){ return i; } ).then( caller, [&]( disruptor::future<int64_t> v ){ sum += v.get(); ++done; } );
+         } );
+      }
+      while( done < n ) usleep(100);
+   };
+   continue_on_caller( 2000 );
+   {
+      int64_t before = allocations;
+      double  start  = now();
+      continue_on_caller( trips );
+      double elapsed = now() - start;
+      report( "async then then: ", trips, elapsed, sum == trips * (trips - 1) / 2, allocations - before );
+   }
+
+   worker.stop();
+   caller.stop();
+   worker.join();
+   caller.join();
+   return 0;
+}
@@ -0,0 +1,69 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <thread>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+/**
+ *  One producer post()s small tasks to a disruptor::thread that also
+ *  polls some idle cursors, rings nobody publishes to.  The run loop
+ *  visits every idle cursor between batches of posts, so this measures
+ *  how well posts are drained in batches.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** @return posts per second, or 0 if a task was lost or an idle handler ran */
+double run( uint32_t idle, int64_t tasks )
+{
+   disruptor::thread t;
+   std::vector<write_cursor_ptr> writers;
+   std::atomic<int64_t> idle_calls(0);
+   for( uint32_t i = 0; i < idle; ++i )
+   {
+      auto w = std::make_shared<write_cursor>("idle",1024);
+      auto r = std::make_shared<read_cursor>("idle");
+      r->follows(w);
+      w->follows(r);
+      writers.push_back(w);
+      t.add_cursor( r, [&]( int64_t begin, int64_t end ) { ++idle_calls; return end; } );
+   }
+   t.start();
+
+   // only touched by t
+   int64_t count = 0;
+   std::atomic<int64_t> finished(-1);
+
+   double start = now();
+   std::thread producer( [&]()
+   {
+      for( int64_t i = 0; i < tasks; ++i )
+         t.post( [&](){ ++count; } );
+      t.post( [&](){ finished = count; } );
+   });
+   producer.join();
+   while( finished.load() < 0 ) usleep( 100 );
+   double elapsed = now() - start;
+
+   t.stop();
+   t.join();
+   if( finished.load() != tasks || idle_calls.load() != 0 ) return 0;
+   return tasks / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t tasks = argc > 1 ? atoll( argv[1] ) : 4 * 1000 * 1000;
+
+   std::cout.precision(15);
+   uint32_t idle[] = { 0, 64 };
+   for( int i = 0; i < 2; ++i )
+      std::cout << "post() with " << idle[i] << " idle cursors: " << run( idle[i], tasks ) << " posts/sec\n";
+   return 0;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+namespace disruptor
+{
+
+/** @return true if t now only runs on cpu, t may be a std::thread::native_handle() */
+inline bool pin_thread( pthread_t t, int cpu )
+{
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   CPU_SET( cpu, &set );
+   return ::pthread_setaffinity_np( t, sizeof(set), &set ) == 0;
+}
+
+/** @return true if the calling thread now only runs on cpu */
+inline bool pin_current_thread( int cpu ) { return pin_thread( ::pthread_self(), cpu ); }
+
+/**
+ *  Where a cpu sits in the machine.  Cores and caches are identified by
+ *  the lowest numbered cpu that shares them, -1 if unknown.
+ */
+struct cpu_info
+{
+   int cpu;
+   /** hyperthreads of one physical core have the same core */
+   int core;
+   int package;
+   int l2;
+   int l3;
+};
+
+/**
+ *  The cpus this process may run on and the caches they share, as read
+ *  from sysfs when the topology is created.
+ *
+ *  place() turns that into a cpu for each stage of a pipeline so that
+ *  tightly coupled threads are not scattered by the os across sockets or
+ *  stacked onto the two hyperthreads of one core.
+ *
+ *  @code
+     auto cpus = cpu_topology().place( 3 );
+     std::thread producer( ... ), filter( ... ), consumer( ... );
+     pin_thread( producer.native_handle(), cpus[0] );
+     pin_thread( filter.native_handle(),   cpus[1] );
+     pin_thread( consumer.native_handle(), cpus[2] );
+ *  @endcode
+ */
+class cpu_topology
+{
+   public:
+      explicit cpu_topology( const std::string& root = "/sys/devices/system/cpu" )
+      {
+         cpu_set_t allowed;
+         CPU_ZERO( &allowed );
+         if( ::sched_getaffinity( 0, sizeof(allowed), &allowed ) != 0 ) return;
+         load( root, allowed );
+      }
+
+      /** reads the cpus in allowed from root, which may be a copy of sysfs */
+      cpu_topology( const std::string& root, const cpu_set_t& allowed ) { load( root, allowed ); }
+
+      const std::vector<cpu_info>& cpus()const { return _cpus; }
+
+      /**
+       *  Picks a cpu for each of stages threads, where neighbouring stages
+       *  exchange the most data.  Cpus are taken package by package and
+       *  cache by cache, so adjacent stages share an L3 and, where cores
+       *  share one, an L2.  Each stage gets a physical core of its own
+       *  while there are enough of them, unless share_cores is set, in
+       *  which case pairs of adjacent stages are put on the hyperthreads
+       *  of one core to share its L1 and L2.  With more stages than cpus
+       *  the assignment wraps around.
+       *
+       *  @return one cpu per stage, empty if the topology is unknown
+       */
+      std::vector<int> place( uint32_t stages, bool share_cores = false )const
+      {
+         std::vector<cpu_info> order( _cpus );
+         std::sort( order.begin(), order.end(), []( const cpu_info& a, const cpu_info& b )
+         {
+            if( a.package != b.package ) return a.package < b.package;
+            if( a.l3      != b.l3 )      return a.l3      < b.l3;
+            if( a.l2      != b.l2 )      return a.l2      < b.l2;
+            if( a.core    != b.core )    return a.core    < b.core;
+            return a.cpu < b.cpu;
+         });
+
+         std::vector<int> list;
+         if( share_cores )
+         {
+            for( auto itr = order.begin(); itr != order.end(); ++itr ) list.push_back( itr->cpu );
+         }
+         else
+         {
+            // the first hyperthread of every core, then the second of every core...
+            std::vector<int> siblings;
+            for( auto itr = order.begin(); itr != order.end(); ++itr )
+            {
+               if( itr == order.begin() || (itr-1)->core != itr->core ) list.push_back( itr->cpu );
+               else                                                   siblings.push_back( itr->cpu );
+            }
+            list.insert( list.end(), siblings.begin(), siblings.end() );
+         }
+
+         std::vector<int> cpus;
+         if( list.empty() ) return cpus;
+         for( uint32_t i = 0; i < stages; ++i ) cpus.push_back( list[i % list.size()] );
+         return cpus;
+      }
+
+      bool same_core( int a, int b )const  { return find(a).core == find(b).core && find(a).core >= 0; }
+      bool shares_l2( int a, int b )const  { return find(a).l2   == find(b).l2   && find(a).l2   >= 0; }
+      bool shares_l3( int a, int b )const  { return find(a).l3   == find(b).l3   && find(a).l3   >= 0; }
+
+   private:
+      void load( const std::string& root, const cpu_set_t& allowed )
+      {
+         for( int c = 0; c < CPU_SETSIZE; ++c )
+         {
+            if( !CPU_ISSET( c, &allowed ) ) continue;
+            std::string dir = root + "/cpu" + std::to_string(c);
+
+            cpu_info info;
+            info.cpu     = c;
+            info.core    = read_first( dir + "/topology/thread_siblings_list", c );
+            info.package = read_first( dir + "/topology/physical_package_id", 0 );
+            info.l2      = -1;
+            info.l3      = -1;
+            for( int i = 0; ; ++i )
+            {
+               std::string index = dir + "/cache/index" + std::to_string(i);
+               int level = read_first( index + "/level", -1 );
+               if( level < 0 ) break;
+               if( read_line( index + "/type" ) == "Instruction" ) continue;
+               if( level == 2 ) info.l2 = read_first( index + "/shared_cpu_list", c );
+               if( level == 3 ) info.l3 = read_first( index + "/shared_cpu_list", c );
+            }
+            _cpus.push_back( info );
+         }
+      }
+
+      static std::string read_line( const std::string& path )
+      {
+         std::ifstream in( path.c_str() );
+         std::string   line;
+         std::getline( in, line );
+         return line;
+      }
+
+      /** @return the first number in a file such as a cpu list "0-3,8-11", or def */
+      static int read_first( const std::string& path, int def )
+      {
+         std::string line = read_line( path );
+         if( line.empty() || line[0] < '0' || line[0] > '9' ) return def;
+         return std::stoi( line );
+      }
+
+      cpu_info find( int cpu )const
+      {
+         for( auto itr = _cpus.begin(); itr != _cpus.end(); ++itr )
+            if( itr->cpu == cpu ) return *itr;
+         cpu_info none = { cpu, -1, -1, -1, -1 };
+         return none;
+      }
+
+      std::vector<cpu_info> _cpus;
+};
+
+} // namespace disruptor
@@ -0,0 +1,86 @@
+#pragma once
+#include "disruptor.hpp"
+#include <algorithm>
+#include <mutex>
+
+namespace disruptor
+{
+
+/**
+ *  A set of member cursors, each driven by its own thread, that are
+ *  seen from the outside as a single event_cursor.  The position of
+ *  the group is the min position of all of its members and is
+ *  republished by the members whenever they make progress, so other
+ *  cursors may follow the group without knowing how many members
+ *  it has.
+ *
+ *  The group reaches eof once every member has hit eof and carries
+ *  the first alert raised by any member.
+ */
+template<typename Member>
+class cursor_group : public event_cursor
+{
+   public:
+      typedef std::shared_ptr<Member> member_ptr;
+
+      /** every member of the group will wait on s */
+      template<typename T>
+      void follows( T&& s )
+      {
+         for( auto itr = _members.begin(); itr != _members.end(); ++itr )
+            (*itr)->follows( s );
+      }
+
+   protected:
+      cursor_group( const char* n )
+      :event_cursor(n),_alerted(false)
+      {
+         _cursor.store(-1);
+         // every member publishes through the group
+         set_shared();
+      }
+
+      /** publishes the min position of every member */
+      void update()
+      {
+         int64_t min_pos = 0x7fffffffffffffff;
+         for( auto itr = _members.begin(); itr != _members.end(); ++itr )
+         {
+            auto itr_pos = (*itr)->pos().aquire();
+            if( itr_pos < min_pos ) min_pos = itr_pos;
+         }
+         if( _cursor.store_max( min_pos ) ) notify();
+      }
+
+      /** 
+       *  Called by m every time its wait throws eof, which it keeps doing
+       *  if it waits again, so each member is only counted once.
+       */
+      void member_eof( const Member& m )
+      {
+         {
+            std::lock_guard<std::mutex> lock( _eof_mutex );
+            if( std::find( _at_eof.begin(), _at_eof.end(), &m ) != _at_eof.end() ) return;
+            _at_eof.push_back( &m );
+            if( _at_eof.size() != _members.size() ) return;
+         }
+         update();
+         set_eof();
+      }
+
+      void member_alert( std::exception_ptr e )
+      {
+         if( !_alerted.exchange(true) )
+            set_alert( std::move(e) );
+      }
+
+      std::vector<member_ptr>       _members;
+
+   private:
+      /** the members that have hit eof, eof is rare enough for a lock */
+      std::mutex                    _eof_mutex;
+      std::vector<const Member*>    _at_eof;
+      std::atomic<bool>             _alerted;
+};
+
+} // namespace disruptor
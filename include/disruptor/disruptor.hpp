@@ -3,9 +3,15 @@
 #include <vector>
 #include <stdint.h>
 #include <unistd.h>
+#include <sched.h>
 #include <atomic>
+#include <mutex>
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
+#include <system_error>
+#include <sys/eventfd.h>
+#include <poll.h>
 
 namespace disruptor
 {
@@ -51,14 +57,295 @@ class sequence
           return tmp;
       }
 
+      /** raises the sequence to value unless another thread
+       *  has already moved it further.
+       *
+       *  @return true if this call raised it
+       */
+      bool    store_max( int64_t value )
+      {
+          auto cur = aquire();
+          while( cur < value )
+          {
+             if( _sequence.compare_exchange_weak( cur, value, std::memory_order_release, 
+                                                              std::memory_order_acquire ) )
+                return true;
+          }
+          return false;
+      }
+
    private:
       std::atomic<int64_t> _sequence;
       volatile int64_t     _alert;
       int64_t              _post_pad[6];
 };
 
+/**
+ *  Lets a thread that has run out of work block in the kernel until a
+ *  cursor it follows makes progress.
+ *
+ *  Cursors notify the waiters registered with them whenever they publish
+ *  but only make a syscall if the waiter is parked, so a busy pipeline
+ *  pays a fence and a load per publish.  So that a notification is never
+ *  missed the waiting thread calls prepare_park(), checks once more for
+ *  work and only then calls park().
+ *
+ *  A waiter also carries up to max_bells doorbells.  A cursor registered
+ *  with a bell rings it when it publishes, so the waiting thread can 
+ *  take() the set of bells rung since it last looked and only check the
+ *  cursors behind them rather than every cursor it serves.  Ringing a 
+ *  bell that is already rung is a load, so a busy producer only writes
+ *  the shared bitmap once per take().
+ */
+class waiter
+{
+   public:
+      enum { words = 64, max_bells = words * 64 };
+
+      waiter():_parked(false),_fd( ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ),_rung_words(0)
+      {
+         if( _fd < 0 ) throw std::system_error( errno, std::system_category(), "eventfd" );
+         for( int i = 0; i < words; ++i ) _rung[i].store( 0, std::memory_order_relaxed );
+      }
+      ~waiter() { ::close( _fd ); }
+
+      /** announces that the caller is about to park, notifications from here on wake it */
+      void prepare_park()
+      {
+         _parked.store( true, std::memory_order_relaxed );
+         std::atomic_thread_fence( std::memory_order_seq_cst );
+      }
+
+      /** called instead of park() if work turned up after prepare_park() */
+      void cancel_park() { _parked.store( false, std::memory_order_relaxed ); }
+
+      /** blocks until woken or timeout_ms has passed, -1 waits forever */
+      void park( int timeout_ms )
+      {
+         pollfd p = { _fd, POLLIN, 0 };
+         ::poll( &p, 1, timeout_ms );
+         finish_park();
+      }
+
+      /** 
+       *  For callers that block on fd() themselves, for example in an 
+       *  epoll set, instead of calling park().
+       */
+      void finish_park()
+      {
+         drain();
+         _parked.store( false, std::memory_order_relaxed );
+      }
+
+      /** clears any pending wake() */
+      void drain()
+      {
+         uint64_t count;
+         ssize_t r = ::read( _fd, &count, sizeof(count) );
+         (void)r;
+      }
+
+      /** readable after wake() until drained */
+      int fd()const { return _fd; }
+
+      /** the caller must issue a seq_cst fence between publishing and checking */
+      bool parked()const { return _parked.load( std::memory_order_relaxed ); }
+
+      /** wakes the parked thread, or the next one to park */
+      void wake()
+      {
+         uint64_t one = 1;
+         ssize_t r = ::write( _fd, &one, sizeof(one) );
+         (void)r;
+      }
+
+      /** 
+       *  Marks bell as rung, the caller must issue a seq_cst fence between 
+       *  publishing and ringing.
+       */
+      void ring( uint32_t bell )
+      {
+         uint32_t w   = bell / 64;
+         uint64_t bit = uint64_t(1) << (bell % 64);
+         if( _rung[w].load( std::memory_order_relaxed ) & bit ) return;
+         _rung[w].fetch_or( bit );
+         // set after the bell, the word bit is cleared before the bells are taken 
+         if( !(_rung_words.load( std::memory_order_relaxed ) & (uint64_t(1) << w)) )
+            _rung_words.fetch_or( uint64_t(1) << w );
+      }
+
+      /** @return true if any bell has been rung since the last take() */
+      bool rung()const { return _rung_words.load( std::memory_order_relaxed ) != 0; }
+
+      /**
+       *  Clears the rung bells and ors them into bells, an array of words
+       *  uint64_t.  Cursors must be checked after the bells are taken.
+       *
+       *  @return a mask of the words of bells that changed
+       */
+      uint64_t take( uint64_t* bells )
+      {
+         if( !rung() ) return 0;
+         uint64_t changed = _rung_words.exchange( 0 );
+         for( uint64_t m = changed; m; m &= m - 1 )
+         {
+            int w = __builtin_ctzll( m );
+            bells[w] |= _rung[w].exchange( 0 );
+         }
+         return changed;
+      }
+
+   private:
+      std::atomic<bool>      _parked;
+      int                    _fd;
+      std::atomic<uint64_t>  _rung_words;
+      std::atomic<uint64_t>  _rung[words];
+};
+
 class event_cursor;
 
+/**
+ *  An immutable list published through an atomic pointer so that one
+ *  thread may replace it while others walk it.  Every replacement bumps
+ *  a version and retires the old list.
+ *
+ *  The owner is the one thread at a time that reads the list on a hot 
+ *  path, such as the thread driving a cursor.  It only loads the version
+ *  and the list: a list it loaded stays alive until its next read, because
+ *  a retired list is only freed once the owner has read the version that
+ *  retired it.  Other readers pin the list, which costs two uncontended
+ *  atomic increments, and nothing is freed while a pin is held.  A shared
+ *  list is read on the hot path by several threads at once, as a cursor
+ *  that many producers publish through is, so every read of it pins.
+ *
+ *  Retired lists are checked when a list is replaced, when the last pin
+ *  is released and when the owner reads a new version, so only lists 
+ *  replaced since the owner's last read, or while a pin was held, are 
+ *  ever kept.  The list may be null, which readers can check with peek()
+ *  before reading it.
+ */
+template<typename List>
+class cow_list
+{
+   public:
+      explicit cow_list( List* l = nullptr )
+      :_list(l),_version(0),_owner_version(0),_pins(0),_has_retired(false),_shared(false){}
+      ~cow_list() { delete _list.load(); }
+
+      /** makes every read pin, must be called before the list is read */
+      void set_shared() { _shared = true; }
+
+      /** keeps the list it loaded alive until destroyed */
+      class pin
+      {
+         public:
+            /** 
+             *  @param owner - true if called by the owner, whose pins
+             *         only load the list unless it is shared
+             */
+            explicit pin( const cow_list& c, bool owner = false )
+            :_c(c),_pinned( !owner || c._shared )
+            {
+               if( !_pinned ) 
+               {
+                  _l = _c.owner_load();
+                  return;
+               }
+               _c._pins.fetch_add( 1 );
+               _l = _c._list.load();
+            }
+            ~pin() { if( _pinned ) _c.unpin(); }
+
+            const List* get()const        { return _l; }
+            const List& operator*()const  { return *_l; }
+            const List* operator->()const { return _l; }
+
+         private:
+            pin( const pin& ) = delete;
+            pin& operator=( const pin& ) = delete;
+
+            const cow_list& _c;
+            const bool      _pinned;
+            const List*     _l;
+      };
+
+      /** 
+       *  The current list, which may be null.  Without a pin it may only
+       *  be compared against, or read while holding mutex().
+       */
+      const List* peek()const { return _list.load( std::memory_order_relaxed ); }
+
+      /** @return how many times the list has been replaced */
+      uint64_t version()const { return _version.load( std::memory_order_acquire ); }
+
+      /** held by writers for as long as they copy and replace the list */
+      std::mutex& mutex()const { return _mutex; }
+
+      /** replaces the list with l, the caller must hold mutex() */
+      void replace( List* l )
+      {
+         std::unique_ptr<const List> old( _list.exchange( l ) );
+         // after the list, an owner that reads this version loads l or later
+         uint64_t v = _version.load( std::memory_order_relaxed ) + 1;
+         _version.store( v, std::memory_order_release );
+         if( old ) _retired.push_back( retired_list( v, std::move(old) ) );
+         _has_retired.store( true );
+         reclaim();
+      }
+
+   private:
+      typedef std::pair<uint64_t,std::unique_ptr<const List>> retired_list;
+
+      /** 
+       *  Read by the owner, which is done with every list it loaded before
+       *  once it sees a new version.
+       */
+      const List* owner_load()const
+      {
+         uint64_t v = _version.load( std::memory_order_acquire );
+         if( v != _owner_version.load( std::memory_order_relaxed ) )
+         {
+            _owner_version.store( v, std::memory_order_release );
+            if( _has_retired.load( std::memory_order_relaxed ) )
+            {
+               std::unique_lock<std::mutex> lock( _mutex, std::try_to_lock );
+               if( lock ) reclaim();
+            }
+         }
+         return _list.load( std::memory_order_acquire );
+      }
+
+      /** the caller must hold _mutex */
+      void reclaim()const
+      {
+         // pairs with pin(), a reader that gets in after this sees the new list
+         if( _pins.load() != 0 ) return;
+         uint64_t seen = _shared ? _version.load( std::memory_order_relaxed ) 
+                                 : _owner_version.load( std::memory_order_acquire );
+         _retired.erase( std::remove_if( _retired.begin(), _retired.end(), 
+                                         [&]( const retired_list& r ){ return r.first <= seen; } ),
+                         _retired.end() );
+         _has_retired.store( !_retired.empty(), std::memory_order_relaxed );
+      }
+
+      void unpin()const
+      {
+         if( _pins.fetch_sub( 1 ) != 1 || !_has_retired.load() ) return;
+         std::unique_lock<std::mutex> lock( _mutex, std::try_to_lock );
+         if( lock ) reclaim();
+      }
+
+      std::atomic<const List*>                          _list;
+      std::atomic<uint64_t>                             _version;
+      /** the version the owner read last, it holds no older list */
+      mutable std::atomic<uint64_t>                     _owner_version;
+      mutable std::atomic<uint32_t>                     _pins;
+      mutable std::atomic<bool>                         _has_retired;
+      bool                                              _shared;
+      mutable std::mutex                                _mutex;
+      mutable std::vector<retired_list>                 _retired;
+};
+
 /**
  *   A barrier will block until all cursors it is following are
  *   have moved past a given position.  The barrier uses a
@@ -70,11 +357,43 @@ class event_cursor;
  *   be 'intrusive' to publishers which must check to see whether
  *   or not they must 'notify'.  The progressive backoff approach
  *   uses little CPU and is a good compromise for most use cases.
+ *
+ *   The set of cursors followed may be changed by any thread while
+ *   another thread waits on the barrier.  Every change publishes a new
+ *   immutable copy of the set in a cow_list, whose owner is the thread
+ *   waiting on the barrier, so get_min() and wait_for() only load a 
+ *   version and a pointer, and replaced sets are freed once that thread
+ *   has moved on from them.  A shared barrier, which several threads 
+ *   wait on at once, pins the set instead.  A waiter that has backed off to yielding or sleeping
+ *   notices a new set and starts over, so removing a stalled cursor 
+ *   releases anyone blocked on it.
+ *
+ *   A barrier that follows nothing holds nothing back, so a writer whose
+ *   last reader was detached or lapped keeps running: wait_for() returns
+ *   pos while get_min() and try_wait_for() return the last min seen.  A
+ *   reader must keep following its sources.
  */
 class barrier 
 {
    public:
-      void follows( std::shared_ptr<const event_cursor> e );
+      barrier():_last_min(-1),_limit_seq( new cursor_list() ){}
+
+      /** 
+       *  Called before the barrier is used if several threads may wait on 
+       *  it at once, as the producers of a shared_write_cursor do.
+       */
+      void set_shared() { _limit_seq.set_shared(); }
+
+      /**
+       *  @param max_lag - how far past e wait_for() may be asked to go
+       *         before e is considered lapped.  Instead of waiting on a 
+       *         lapped cursor the barrier stops following it and calls 
+       *         e->lapped().  By default e is never lapped.
+       */
+      void follows( std::shared_ptr<const event_cursor> e, int64_t max_lag = 0x7fffffffffffffff );
+
+      /** stops waiting on e, after which e no longer limits get_min() or wait_for() */
+      void unfollow( const std::shared_ptr<const event_cursor>& e );
 
       /**
        *  Used to check how much you can read/write without blocking.
@@ -89,10 +408,44 @@ class barrier
        *
        *  @return the minimum value of every dependency
        */
-      int64_t wait_for( int64_t pos )const;
+      int64_t wait_for( int64_t pos );
+
+      /**
+       *  Non-blocking version of wait_for(), the result may be less than pos.
+       *  Throws like wait_for() if a followed cursor has set eof or an
+       *  alert short of pos.
+       *
+       *  @return the minimum value of every dependency
+       */
+      int64_t try_wait_for( int64_t pos )const;
+
+      /** 
+       *  @return how many times the followed set has changed, a caller that
+       *          saw the same count before and after followed() has the
+       *          current set
+       */
+      uint32_t changes()const { return uint32_t( _limit_seq.version() ); }
+
+      /** @return the cursors currently followed */
+      std::vector<std::shared_ptr<const event_cursor>> followed()const;
    private:
+      struct follower
+      {
+         std::shared_ptr<const event_cursor>  cursor;
+         int64_t                              max_lag;
+
+         const event_cursor* operator->()const { return cursor.get(); }
+      };
+      typedef std::vector<follower> cursor_list;
+
+      /** 
+       *  Waits on the set followed when it is called.
+       *  @return false if the set changed and the wait must start over
+       */
+      bool wait_on_set( int64_t pos, int64_t& min_pos );
+
       mutable int64_t                                   _last_min;
-      std::vector<std::shared_ptr<const event_cursor>>  _limit_seq;
+      cow_list<cursor_list>                             _limit_seq;
 };
 
 /**
@@ -204,8 +557,8 @@ class ring_buffer
 class event_cursor
 {
    public:
-      event_cursor(int64_t b=-1):_name(""),_begin(b),_end(b){}
-      event_cursor(const char* n, int64_t b=0):_name(n),_begin(b),_end(b){}
+      event_cursor(int64_t b=-1):_name(""),_begin(b),_end(b),_laps(0){}
+      event_cursor(const char* n, int64_t b=0):_name(n),_begin(b),_end(b),_laps(0){}
 
       /** this event processor will process every event
        *  upto, but not including s
@@ -213,6 +566,15 @@ class event_cursor
       template<typename T>
       void follows( T&& s ) { _barrier.follows(std::forward<T>(s)); }
 
+      /** stops following s, this may be called while the cursor is waiting */
+      void unfollow( const std::shared_ptr<const event_cursor>& s ) { _barrier.unfollow(s); }
+
+      /** @return the cursors this one currently follows */
+      std::vector<std::shared_ptr<const event_cursor>> followed()const { return _barrier.followed(); }
+
+      /** @return a count that changes whenever followed() does */
+      uint32_t followed_changes()const { return _barrier.changes(); }
+
       /** returns one after cursor */
       int64_t begin()const { return _begin; }
 
@@ -226,10 +588,11 @@ class event_cursor
          check_alert();
          _begin = p + 1;
          _cursor.store( p );
+         notify();
       }
 
       /** when the cusor hits the end of a stream, it can set the eof flag */
-      void set_eof(){ _cursor.set_eof(); }
+      void set_eof(){ _cursor.set_eof(); notify(); }
 
       /** If an error occurs while processing data the cursor can set an 
        *  alert that will be thrown whenever another cursor attempts to wait
@@ -239,6 +602,7 @@ class event_cursor
       {   
           _alert = std::move(e); 
           _cursor.set_alert(); 
+          notify();
       }
 
       /** @return any alert set on this cursor */
@@ -256,7 +620,72 @@ class event_cursor
       /** used for debug messages */
       const char* name()const { return _name; }
 
+      /** 
+       *  Called by a cursor that stopped waiting on this one because it
+       *  fell further behind than it was allowed to.
+       */
+      void     lapped()const { _laps.fetch_add( 1, std::memory_order_release ); }
+
+      /** @return how many times lapped() has been called */
+      uint32_t laps()const   { return _laps.load( std::memory_order_acquire ); }
+
+      /** 
+       *  w is notified whenever this cursor publishes, sets eof or sets an
+       *  alert, and bell is rung first unless it is -1.
+       */
+      void add_waiter( std::shared_ptr<waiter> w, int32_t bell = -1 )const;
+      void remove_waiter( const std::shared_ptr<waiter>& w, int32_t bell = -1 )const;
+
+      /**
+       *  Registers w with every cursor this one follows so that w is woken
+       *  and bell rung when any of them makes progress.  Cursors followed
+       *  later are not registered.
+       */
+      void wake_on_progress( const std::shared_ptr<waiter>& w, int32_t bell = -1 )const
+      {
+          auto f = _barrier.followed();
+          for( auto itr = f.begin(); itr != f.end(); ++itr ) (*itr)->add_waiter( w, bell );
+      }
+      void stop_wake_on_progress( const std::shared_ptr<waiter>& w, int32_t bell = -1 )const
+      {
+          auto f = _barrier.followed();
+          for( auto itr = f.begin(); itr != f.end(); ++itr ) (*itr)->remove_waiter( w, bell );
+      }
+
     protected:
+      /** 
+       *  Called by the constructors of cursors that several threads publish
+       *  or wait through at once, so that their lists are pinned.
+       */
+      void set_shared()
+      {
+         _barrier.set_shared();
+         _waiters.set_shared();
+      }
+
+      struct registration
+      {
+         std::shared_ptr<waiter> w;
+         int32_t                 bell;
+         bool operator == ( const registration& r )const { return w == r.w && bell == r.bell; }
+      };
+      typedef std::vector<registration> waiter_list;
+
+      /** rings the bells and wakes any parked waiter, costs a load when there are none */
+      void notify()const
+      {
+          if( !_waiters.peek() ) return;
+          std::atomic_thread_fence( std::memory_order_seq_cst );
+          // the publisher owns the list, unless the cursor is shared
+          cow_list<waiter_list>::pin w( _waiters, true );
+          if( !w.get() ) return;
+          for( auto itr = w->begin(); itr != w->end(); ++itr )
+          {
+             if( itr->bell >= 0 ) itr->w->ring( itr->bell );
+             if( itr->w->parked() ) itr->w->wake();
+          }
+      }
+
       /** last know available, min(_limit_seq) */
       const char*                   _name;
       int64_t                       _begin;
@@ -264,6 +693,10 @@ class event_cursor
       std::exception_ptr            _alert;
       barrier                       _barrier;
       sequence                      _cursor;
+      mutable std::atomic<uint32_t> _laps;
+
+      /** copied on write like the barrier's cursor list, null while there are none */
+      mutable cow_list<waiter_list> _waiters;
 };
 
 /**
@@ -289,6 +722,26 @@ class read_cursor : public event_cursor
       {
           return _end = _barrier.get_min() + 1;
       }
+
+      /** 
+       *  Like wait_for() but returns immediately, end() may be <= pos.  
+       *  Throws eof once the stream has ended before pos.
+       */
+      int64_t try_wait_for( int64_t pos )
+      {
+         try {
+          return _end = _barrier.try_wait_for(pos) + 1;
+         }
+         catch ( const eof& ) { _cursor.set_eof(); throw; }
+         catch ( ... ) { set_alert( std::current_exception() ); throw; }
+      }
+
+      /** moves a cursor that is not in use yet to just after pos */
+      void start_at( int64_t pos )
+      {
+          _begin = _end = pos + 1;
+          _cursor.store( pos );
+      }
 };
 
 typedef std::shared_ptr<read_cursor> read_cursor_ptr;
@@ -325,6 +778,22 @@ class write_cursor : public event_cursor
          _cursor.store(-1);
       }
 
+      using event_cursor::follows;
+
+      /**
+       *  Waits on e like follows(e) as long as e is no more than lag_limit
+       *  events behind this cursor.  Once e falls further behind, this cursor
+       *  stops waiting on it and calls e->lapped() so that a slow optional
+       *  reader cannot hold back the rest of the pipeline.
+       */
+      void follows( std::shared_ptr<const event_cursor> e, int64_t lag_limit )
+      {
+         _barrier.follows( std::move(e), lag_limit - _size );
+      }
+
+      /** @return the size of the buffer */
+      int64_t size()const { return _size; }
+
       /** waits for begin() to be valid and then
        *  returns it.  This is only safe for 
        *  single producers, multi-producers should 
@@ -383,14 +852,14 @@ class shared_write_cursor : public write_cursor
        *  required to do proper wrap detection 
        **/
       shared_write_cursor(int64_t s)
-      :write_cursor(s){}
+      :write_cursor(s){ set_shared(); }
 
       /**
        * @param n - name of the cursor for debug purposes
        * @param s - the size of the buffer.  
        */
       shared_write_cursor(const char* n, int64_t s)
-      :write_cursor(n,s){}
+      :write_cursor(n,s){ set_shared(); }
 
       /** When there are multiple writers they cannot both
        *  assume the right to write to begin() to end(), 
@@ -411,11 +880,25 @@ class shared_write_cursor : public write_cursor
            return pos - num_slots;
       }
 
+      /**
+       *  Publishes the claim ending at pos once every claim before it, 
+       *  ending at after_pos, has been published, so readers never see a
+       *  slot whose producer has not finished writing it.  Only other
+       *  producers are waited on: space was already reserved by claim(),
+       *  so the readers need not catch up first, and a producer that is
+       *  also the reader, such as a thread posting to itself, cannot 
+       *  deadlock here.
+       *
+       *  The producer waited on may have been preempted between claim()
+       *  and publishing, so after a short spin this yields the CPU to it
+       *  rather than sleeping.
+       */
       void publish_after( int64_t pos, int64_t after_pos )
       {
          try {
             assert( pos > after_pos );
-             _barrier.wait_for(after_pos);
+            for( int i = 0; _cursor.aquire() < after_pos; ++i )
+               if( i > 1000 ) sched_yield();
             publish( pos );
          }
          catch ( const eof& ) { _cursor.set_eof(); throw; }
@@ -427,17 +910,69 @@ class shared_write_cursor : public write_cursor
 };
 typedef std::shared_ptr<shared_write_cursor> shared_write_cursor_ptr;
 
+/**
+ *  Adds c to a running pipeline.  c starts just after the current position
+ *  of source, waits on source and from then on gates writer.  source must
+ *  be writer or a cursor that writer waits on.
+ *
+ *  c gates writer before it picks the position it starts from, so writer
+ *  cannot lap c: from then on writer waits on c, and what writer was 
+ *  allowed to write before was bounded by cursors at or behind source's 
+ *  position at that point.  Until c is moved up it holds writer back 
+ *  to where source was when it was registered.
+ */
+inline void attach( const read_cursor_ptr& c, 
+                    const std::shared_ptr<const event_cursor>& source,
+                    const std::shared_ptr<event_cursor>& writer )
+{
+    c->follows( source );
+    c->start_at( source->pos().aquire() );
+    writer->follows( c );
+    c->start_at( source->pos().aquire() );
+}
 
+/** attaches c directly behind writer */
+inline void attach( const read_cursor_ptr& c, const std::shared_ptr<event_cursor>& writer )
+{
+    attach( c, writer, writer );
+}
 
-inline void barrier::follows( std::shared_ptr<const event_cursor> e )
+/**
+ *  Removes c from a running pipeline so that it no longer holds back writer,
+ *  whatever state c or the thread driving it is in.
+ */
+inline void detach( const read_cursor_ptr& c, const std::shared_ptr<event_cursor>& writer )
 {
-    _limit_seq.push_back( std::move(e) );
+    writer->unfollow( c );
+}
+
+
+
+inline void barrier::follows( std::shared_ptr<const event_cursor> e, int64_t max_lag )
+{
+    std::lock_guard<std::mutex> lock( _limit_seq.mutex() );
+    auto next = new cursor_list( *_limit_seq.peek() );
+    follower f = { std::move(e), max_lag };
+    next->push_back( std::move(f) );
+    _limit_seq.replace( next );
+}
+
+inline void barrier::unfollow( const std::shared_ptr<const event_cursor>& e )
+{
+    std::lock_guard<std::mutex> lock( _limit_seq.mutex() );
+    auto next = new cursor_list( *_limit_seq.peek() );
+    next->erase( std::remove_if( next->begin(), next->end(), 
+                                 [&]( const follower& f ){ return f.cursor == e; } ), 
+                 next->end() );
+    _limit_seq.replace( next );
 }
 
 inline int64_t barrier::get_min()
 {
+   cow_list<cursor_list>::pin limit_seq( _limit_seq, true );
+   if( limit_seq->empty() ) return _last_min;
    int64_t min_pos = 0x7fffffffffffffff;
-   for( auto itr = _limit_seq.begin(); itr != _limit_seq.end(); ++itr )
+   for( auto itr = limit_seq->begin(); itr != limit_seq->end(); ++itr )
    {
       auto itr_pos = (*itr)->pos().aquire();
       if( itr_pos < min_pos ) min_pos = itr_pos;
@@ -445,16 +980,37 @@ inline int64_t barrier::get_min()
    return _last_min = min_pos;
 }
 
-inline int64_t barrier::wait_for( int64_t pos )const
+inline int64_t barrier::wait_for( int64_t pos )
 {
    if( _last_min > pos ) 
       return _last_min;
 
-   int64_t min_pos = 0x7fffffffffffffff;
-   for( auto itr = _limit_seq.begin(); itr != _limit_seq.end(); ++itr )
+   int64_t min_pos;
+   while( !wait_on_set( pos, min_pos ) ) {}
+   return min_pos;
+}
+
+inline bool barrier::wait_on_set( int64_t pos, int64_t& min_pos )
+{
+   cow_list<cursor_list>::pin limit_seq( _limit_seq, true );
+   if( limit_seq->empty() ) 
+   {
+      min_pos = pos;
+      return true;
+   }
+   min_pos = 0x7fffffffffffffff;
+   for( auto itr = limit_seq->begin(); itr != limit_seq->end(); ++itr )
    {
       int64_t itr_pos = 0;
       itr_pos = (*itr)->pos().aquire();
+      if( itr_pos < pos && pos - itr_pos > itr->max_lag )
+      {
+         // too far behind to be worth waiting on
+         auto lapped = itr->cursor;
+         unfollow( lapped );
+         lapped->lapped();
+         return false;
+      }
       // spin for a bit 
       for( int i = 0; itr_pos < pos && i < 10000; ++i  )
       {
@@ -467,6 +1023,9 @@ inline int64_t barrier::wait_for( int64_t pos )const
          usleep(0);
          itr_pos = (*itr)->pos().aquire();
          if( (*itr)->pos().alert() ) break;
+         // the cursor we are stuck on may have been removed
+         if( _limit_seq.peek() != limit_seq.get() ) 
+            return false;
       }
 
       // queue stalled, don't peg the CPU but don't wait
@@ -476,24 +1035,83 @@ inline int64_t barrier::wait_for( int64_t pos )const
          usleep( 10*1000 );
          itr_pos = (*itr)->pos().aquire();
          if( (*itr)->pos().alert() ) break;
+         if( _limit_seq.peek() != limit_seq.get() ) 
+            return false;
       }
 
-      if( (*itr)->pos().alert() )
+      // eof is set after the last publish, so check it before reloading
+      // the position, everything up to and including itr_pos is valid.
+      if( itr_pos < pos && (*itr)->pos().alert() )
       {
          (*itr)->check_alert();
-         if( itr_pos > pos ) 
-            return itr_pos -1; // process everything up to itr_pos
-         throw eof();
+         if( (itr_pos = (*itr)->pos().aquire()) < pos )
+            throw eof();
       }
 
 
       if( itr_pos < min_pos ) 
           min_pos = itr_pos; 
    }
-   assert( min_pos != 0x7fffffffffffffff );
+   _last_min = min_pos;
+   return true;
+}
+
+inline int64_t barrier::try_wait_for( int64_t pos )const
+{
+   if( _last_min >= pos ) 
+      return _last_min;
+
+   cow_list<cursor_list>::pin limit_seq( _limit_seq, true );
+   if( limit_seq->empty() ) return _last_min;
+   int64_t min_pos = 0x7fffffffffffffff;
+   for( auto itr = limit_seq->begin(); itr != limit_seq->end(); ++itr )
+   {
+      int64_t itr_pos = (*itr)->pos().aquire();
+      // eof is set after the last publish, so check it before
+      // reloading the position.
+      if( itr_pos < pos && (*itr)->pos().alert() && (itr_pos = (*itr)->pos().aquire()) < pos )
+      {
+         (*itr)->check_alert();
+         throw eof();
+      }
+      if( itr_pos < min_pos ) 
+          min_pos = itr_pos; 
+   }
    return _last_min = min_pos;
 }
 
+inline std::vector<std::shared_ptr<const event_cursor>> barrier::followed()const
+{
+    cow_list<cursor_list>::pin l( _limit_seq );
+    std::vector<std::shared_ptr<const event_cursor>> f;
+    for( auto itr = l->begin(); itr != l->end(); ++itr ) f.push_back( itr->cursor );
+    return f;
+}
+
+inline void event_cursor::add_waiter( std::shared_ptr<waiter> w, int32_t bell )const
+{
+    std::unique_lock<std::mutex> lock( _waiters.mutex() );
+    auto cur = _waiters.peek();
+    registration r = { std::move(w), bell };
+    if( cur && std::find( cur->begin(), cur->end(), r ) != cur->end() ) return;
+    std::unique_ptr<waiter_list> l( cur ? new waiter_list( *cur ) : new waiter_list() );
+    l->push_back( std::move(r) );
+    _waiters.replace( l.release() );
+}
+
+inline void event_cursor::remove_waiter( const std::shared_ptr<waiter>& w, int32_t bell )const
+{
+    std::unique_lock<std::mutex> lock( _waiters.mutex() );
+    auto cur = _waiters.peek();
+    registration r = { w, bell };
+    if( !cur || std::find( cur->begin(), cur->end(), r ) == cur->end() ) return;
+    std::unique_ptr<waiter_list> l( new waiter_list( *cur ) );
+    l->erase( std::remove( l->begin(), l->end(), r ), l->end() );
+    // back to a single load in notify() once the last waiter leaves
+    if( l->empty() ) l.reset();
+    _waiters.replace( l.release() );
+}
+
 inline void event_cursor::check_alert()const
 {
     if( _alert != std::exception_ptr() ) std::rethrow_exception( _alert );
@@ -0,0 +1,155 @@
+#pragma once
+#include "disruptor.hpp"
+
+namespace disruptor
+{
+
+/**
+ *  Lets a single consumer drain many rings, typically one single producer
+ *  ring per producer thread, instead of having every producer contend on
+ *  one shared_write_cursor.
+ *
+ *  Rings are visited round-robin and the ring visited first rotates on
+ *  every poll() so no ring is systematically favoured.  Each ring has
+ *  a batch limit, the most events passed to a single handler call, and
+ *  a weight, the number of batches it may take per visit.
+ *
+ *  When every ring is empty wait() blocks once across all of them using
+ *  the same progressive backoff as a barrier.
+ *
+ *  @code
+      fan_in in;
+      for( uint32_t i = 0; i < producers.size(); ++i )
+      {
+         auto r = std::make_shared<read_cursor>("r");
+         r->follows( producers[i] );
+         producers[i]->follows( r );
+         in.add( r, 64 );
+      }
+
+      auto handle = [&]( uint32_t ring, int64_t begin, int64_t end ) -> int64_t
+      {
+         for( auto pos = begin; pos < end; ++pos )
+            process( buffers[ring]->at(pos) );
+         return end;
+      };
+
+      try {
+         while( true )
+            if( !in.poll( handle ) ) in.wait();
+      } catch ( const eof& ) {}
+ *  @endcode
+ */
+class fan_in
+{
+   public:
+      fan_in():_next(0),_done(0){}
+
+      /**
+       *  @param max_batch - the most events passed to one handler call
+       *  @param weight    - the number of batches taken from c per visit
+       *  @return the index of c passed to handlers
+       */
+      uint32_t add( read_cursor_ptr c, int64_t max_batch = 64, uint32_t weight = 1 )
+      {
+         assert( max_batch > 0 && weight > 0 );
+         _rings.push_back( ring( std::move(c), max_batch, weight ) );
+         return _rings.size() - 1;
+      }
+
+      /**
+       *  Visits every ring once, calling h( index, begin, end ) for each
+       *  batch available.  Like thread::handler, h returns the first
+       *  event it did not process and progress is published for it.
+       *
+       *  @return the number of events processed
+       */
+      template<typename Handler>
+      int64_t poll( Handler&& h )
+      {
+         int64_t  count = 0;
+         uint32_t n     = _rings.size();
+         for( uint32_t i = 0; i < n; ++i )
+         {
+            uint32_t idx = _next + i < n ? _next + i : _next + i - n;
+            ring&    r   = _rings[idx];
+
+            for( uint32_t b = 0; b < r.weight; ++b )
+            {
+               if( r.pos == r.end && !refresh(r) ) break;
+
+               auto next = h( idx, r.pos, std::min( r.end, r.pos + r.max_batch ) );
+               if( next <= r.pos ) break;
+
+               r.cur->publish( next - 1 );
+               count += next - r.pos;
+               r.pos  = next;
+            }
+         }
+         if( ++_next >= n ) _next = 0;
+         return count;
+      }
+
+      /**
+       *  Blocks until at least one ring has events available.
+       *
+       *  @throw eof once every ring has reached eof
+       */
+      void wait()
+      {
+         for( uint32_t i = 0; !ready(); ++i )
+         {
+            if( i < 10000 )      continue;     // spin for a bit
+            else if( i < 20000 ) usleep(0);    // yield for a while
+            else                 usleep( 10*1000 );
+         }
+      }
+
+      uint32_t size()const { return _rings.size(); }
+
+   private:
+      struct ring
+      {
+         ring( read_cursor_ptr c, int64_t b, uint32_t w )
+         :pos(c->begin()),end(c->end()),max_batch(b),weight(w),done(false),cur(std::move(c)){}
+
+         int64_t           pos;
+         int64_t           end;
+         int64_t           max_batch;
+         uint32_t          weight;
+         bool              done;
+         read_cursor_ptr   cur;
+      };
+
+      /** @return true if more events became available for r */
+      bool refresh( ring& r )
+      {
+         if( r.done ) return false;
+         try
+         {
+            r.end = r.cur->try_wait_for( r.pos );
+         }
+         catch ( const eof& )
+         {
+            r.done = true;
+            ++_done;
+            return false;
+         }
+         return r.pos < r.end;
+      }
+
+      bool ready()
+      {
+         for( auto itr = _rings.begin(); itr != _rings.end(); ++itr )
+            if( itr->pos < itr->end || refresh( *itr ) ) return true;
+
+         if( _done == _rings.size() ) throw eof();
+         return false;
+      }
+
+      std::vector<ring>  _rings;
+      uint32_t           _next;
+      uint32_t           _done;
+};
+
+} // namespace disruptor
@@ -0,0 +1,277 @@
+#pragma once
+#include "disruptor.hpp"
+#include <climits>
+#include <type_traits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+namespace disruptor
+{
+   template<typename T> class future;
+
+   namespace detail
+   {
+        inline void futex_wait( std::atomic<int>* addr, int val )
+        {
+            ::syscall( SYS_futex, (int*)addr, FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0 );
+        }
+        inline void futex_wake( std::atomic<int>* addr )
+        {
+            ::syscall( SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0 );
+        }
+
+        /** what is stored for a future<void> */
+        struct unit {};
+
+        template<typename T>
+        struct future_value
+        {
+            typedef T type;
+            template<typename F>
+            static void set( void* p, F& f ) { new (p) T( f() ); }
+            static T    get( void* p )       { return std::move( *((T*)p) ); }
+        };
+
+        template<>
+        struct future_value<void>
+        {
+            typedef unit type;
+            template<typename F>
+            static void set( void* p, F& f ) { f(); new (p) unit(); }
+            static void get( void* )         {}
+        };
+
+        /**
+         *  The state shared by a future and the call producing its value.
+         *
+         *  States come from a per thread free list and go back to the
+         *  free list of whichever thread releases them last.  A future
+         *  that has seen its value waits for the call to drop its
+         *  reference, which it does right after setting the value, so
+         *  states return to the thread that uses the futures and in 
+         *  steady state async() does not allocate.  The continuation, if 
+         *  any, is stored inline.
+         */
+        template<typename T>
+        class future_state
+        {
+            public:
+               typedef typename future_value<T>::type value_type;
+
+               enum status { pending, ready, continued, blocked };
+               enum { continuation_size = 64 };
+
+               /** @return a pending state with a reference for the future and one for the call */
+               static future_state* create()
+               {
+                   free_list&    l = pool();
+                   future_state* s = l.head;
+                   if( s ) { l.head = s->_next; --l.size; }
+                   else    { s = new future_state(); }
+                   s->_refs.store( 2, std::memory_order_relaxed );
+                   return s;
+               }
+
+               void release()
+               {
+                   if( _refs.fetch_sub( 1, std::memory_order_acq_rel ) != 1 ) return;
+                   if( _has_value ) ((value_type*)&_value)->~value_type();
+                   _has_value = false;
+                   _error     = std::exception_ptr();
+                   _status.store( pending, std::memory_order_relaxed );
+
+                   free_list& l = pool();
+                   if( l.size >= max_pooled ) { delete this; return; }
+                   _next  = l.head;
+                   l.head = this;
+                   ++l.size;
+               }
+
+               /** releases the future's reference after the value was set */
+               void release_ready()
+               {
+                   for( int i = 0; _refs.load( std::memory_order_acquire ) > 1; ++i )
+                      if( i > 1000 ) usleep(0);
+                   release();
+               }
+
+               /** calls f, stores its result or exception and notifies whoever waits */
+               template<typename F>
+               void run( F& f )
+               {
+                   try
+                   {
+                      future_value<T>::set( &_value, f );
+                      _has_value = true;
+                   }
+                   catch ( ... )
+                   {
+                      _error = std::current_exception();
+                   }
+                   int prev = _status.exchange( ready, std::memory_order_acq_rel );
+                   if( prev == blocked )        futex_wake( &_status );
+                   else if( prev == continued ) _post_continuation( this );
+               }
+
+               bool is_ready()const { return _status.load( std::memory_order_acquire ) == ready; }
+
+               /** spins briefly and then blocks on a futex until the value is set */
+               void wait()
+               {
+                   for( int i = 0; i < 1000; ++i )
+                      if( is_ready() ) return;
+
+                   int s = _status.load( std::memory_order_acquire );
+                   while( s != ready )
+                   {
+                      if( s == blocked || _status.compare_exchange_strong( s, blocked ) )
+                         futex_wait( &_status, blocked );
+                      s = _status.load( std::memory_order_acquire );
+                   }
+               }
+
+               T get()
+               {
+                   wait();
+                   if( _error != std::exception_ptr() ) std::rethrow_exception( _error );
+                   return future_value<T>::get( &_value );
+               }
+
+               /**
+                *  Has f posted to t with a ready future<T> once the value is
+                *  set, taking over the reference held by the future.
+                */
+               template<typename Thread, typename F>
+               void then( Thread& t, F&& f )
+               {
+                   typedef typename std::decay<F>::type Fn;
+                   static_assert( sizeof(Fn) <= continuation_size, "continuations must capture no more than 64 bytes" );
+
+                   new (&_continuation) Fn( std::forward<F>(f) );
+                   _continuation_thread = &t;
+                   _post_continuation   = &post_continuation<Thread,Fn>;
+
+                   int expected = pending;
+                   if( !_status.compare_exchange_strong( expected, continued, std::memory_order_acq_rel ) )
+                      post_continuation<Thread,Fn>( this );
+               }
+
+            private:
+               enum { max_pooled = 1024 };
+
+               struct free_list
+               {
+                   free_list():head(nullptr),size(0){}
+                   ~free_list()
+                   {
+                      while( head ) { auto n = head->_next; delete head; head = n; }
+                   }
+                   future_state* head;
+                   uint32_t      size;
+               };
+
+               static free_list& pool()
+               {
+                   static thread_local free_list l;
+                   return l;
+               }
+
+               future_state():_status(pending),_has_value(false),_next(nullptr){}
+
+               template<typename Thread, typename Fn>
+               static void post_continuation( future_state* s )
+               {
+                   ((Thread*)s->_continuation_thread)->atomic_post( [s]() { run_continuation<Fn>( s ); } );
+               }
+
+               template<typename Fn>
+               static void run_continuation( future_state* s )
+               {
+                   future<T> f( s );
+                   struct guard
+                   {
+                      Fn* c;
+                      ~guard() { c->~Fn(); }
+                   } g = { (Fn*)&s->_continuation };
+                   (*g.c)( std::move(f) );
+               }
+
+               std::atomic<int>                                                 _refs;
+               std::atomic<int>                                                 _status;
+               bool                                                             _has_value;
+               typename std::aligned_storage<sizeof(value_type),
+                                             std::alignment_of<value_type>::value>::type  _value;
+               std::exception_ptr                                               _error;
+               void*                                                            _continuation_thread;
+               void                                                           (*_post_continuation)( future_state* );
+               typename std::aligned_storage<continuation_size>::type           _continuation;
+               future_state*                                                    _next;
+        };
+   }
+
+   /**
+    *  The result of thread::async().
+    *
+    *  The value may be retrieved once, either by blocking in get() or by
+    *  handing the future to a continuation with then().
+    *
+    *  @code
+         auto f = worker.async( [=]() { return lookup( key ); } );
+         use( f.get() );
+
+         // or, from code running on disruptor::thread self
+         worker.async( [=]() { return lookup( key ); } )
+               .then( self, [=]( future<value> v ) { use( v.get() ); } );
+    *  @endcode
+    */
+   template<typename T>
+   class future
+   {
+      public:
+         future():_state(nullptr){}
+         explicit future( detail::future_state<T>* s ):_state(s){}
+         future( future&& f ):_state(f._state) { f._state = nullptr; }
+         ~future() 
+         { 
+            if( !_state ) return;
+            if( _state->is_ready() ) _state->release_ready();
+            else                     _state->release();
+         }
+
+         future& operator=( future&& f )
+         {
+            std::swap( _state, f._state );
+            return *this;
+         }
+
+         /** @return false once the value has been handed to a continuation */
+         bool valid()const { return _state != nullptr; }
+
+         /** @return true if get() will not block */
+         bool ready()const { return _state->is_ready(); }
+
+         void wait() { _state->wait(); }
+
+         /** blocks until the call completes, rethrows anything it threw */
+         T get() { return _state->get(); }
+
+         /**
+          *  Posts f to t once the value is ready, passing it this future.
+          *  This future is no longer valid afterward.
+          */
+         template<typename Thread, typename F>
+         void then( Thread& t, F&& f )
+         {
+            auto s = _state;
+            _state = nullptr;
+            s->then( t, std::forward<F>(f) );
+         }
+
+      private:
+         future( const future& );
+         future& operator=( const future& );
+
+         detail::future_state<T>* _state;
+   };
+
+} // namespace disruptor
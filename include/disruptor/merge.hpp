@@ -0,0 +1,265 @@
+#pragma once
+#include "disruptor.hpp"
+
+namespace disruptor
+{
+
+/**
+ *  Merges several input rings, each already ordered by timestamp, into a
+ *  single output ring ordered by timestamp.
+ *
+ *  The next event to emit is chosen with a loser tree over the heads of
+ *  the inputs.  The tree keeps one slot per input in a flat array, so
+ *  replacing the winner costs log2(inputs) compares along a single path
+ *  without touching the other heads.
+ *
+ *  An input with nothing available may still produce an earlier event,
+ *  so it takes part in the tree with the timestamp of the last event it
+ *  produced as a lower bound and the merge waits while that bound is the
+ *  smallest key.  The lookahead bounds that wait: once the newest event
+ *  available on any input is more than lookahead ahead of an idle input,
+ *  the idle input is assumed to have nothing older and its bound is
+ *  raised.  The default lookahead waits for every input.
+ *
+ *  Output is published in batches of up to max_batch events and input
+ *  progress is published along with each batch.
+ *
+ *  @code
+      struct tick_time { int64_t operator()( const tick& t )const { return t.time; } };
+      typedef merge_stage< ring_buffer<tick,1024>, ring_buffer<tick,4096>, tick_time > merger;
+
+      auto out_cursor = std::make_shared<write_cursor>("merged",4096);
+      merger m( out, out_cursor, 1000 );
+      for( uint32_t i = 0; i < feeds.size(); ++i )
+      {
+         auto r = std::make_shared<read_cursor>("feed");
+         r->follows( feed_cursors[i] );
+         feed_cursors[i]->follows( r );
+         m.add_input( feeds[i], r );
+      }
+      std::thread( [&](){ m.run(); } );
+ *  @endcode
+ */
+template<typename InputBuffer, typename OutputBuffer, typename Timestamp>
+class merge_stage
+{
+   public:
+      merge_stage( std::shared_ptr<OutputBuffer> out, write_cursor_ptr out_cursor,
+                   int64_t lookahead = 0x7fffffffffffffff, int64_t max_batch = 64,
+                   Timestamp ts = Timestamp() )
+      :_out(std::move(out)),_out_cursor(std::move(out_cursor)),
+       _lookahead(lookahead),_max_batch(max_batch),_newest(-0x7fffffffffffffff-1),_ts(ts)
+      {
+         assert( max_batch > 0 && lookahead >= 0 );
+      }
+
+      void add_input( std::shared_ptr<const InputBuffer> buf, read_cursor_ptr c )
+      {
+         _inputs.push_back( input( std::move(buf), std::move(c) ) );
+      }
+
+      /**
+       *  Merges until every input has reached eof and then sets eof on
+       *  the output.  An alert on any input is set on the output cursor
+       *  and rethrown.
+       */
+      void run()
+      {
+         try
+         {
+            build();
+            merge();
+            _out_cursor->set_eof();
+         }
+         catch ( ... )
+         {
+            _out_cursor->set_alert( std::current_exception() );
+            throw;
+         }
+      }
+
+   private:
+      enum state { ready = 0, idle = 1, done = 2 };
+
+      struct input
+      {
+         input( std::shared_ptr<const InputBuffer> b, read_cursor_ptr c )
+         :pos(c->begin()),end(c->end()),bound(-0x7fffffffffffffff-1),buf(std::move(b)),cur(std::move(c)){}
+
+         int64_t                              pos;
+         int64_t                              end;
+         /** no future event on an idle input is older than bound */
+         int64_t                              bound;
+         std::shared_ptr<const InputBuffer>   buf;
+         read_cursor_ptr                      cur;
+      };
+
+      /** ready inputs win ties against idle ones so equal timestamps never wait */
+      struct key
+      {
+         int64_t  ts;
+         uint32_t st;
+         bool operator < ( const key& k )const { return ts < k.ts || (ts == k.ts && st < k.st); }
+      };
+
+      void merge()
+      {
+         auto pos = _out_cursor->begin();
+         auto end = _out_cursor->end();
+         for( uint32_t spin = 0; _keys[_tree[0]].st != done; )
+         {
+            auto batch_end = pos + _max_batch;
+            auto start     = pos;
+            while( pos < batch_end )
+            {
+               auto   w  = _tree[0];
+               input& in = _inputs[w];
+               if( _keys[w].st == done ) break;
+               if( _keys[w].st == idle )
+               {
+                  if( !refresh( w ) ) break;
+                  continue;
+               }
+               if( pos >= end )
+               {
+                  // let the readers of the output catch up on what we
+                  // have so far before blocking on them.
+                  publish( pos );
+                  end = _out_cursor->wait_for( pos );
+               }
+               _out->at(pos) = in.buf->at(in.pos);
+               ++pos;
+               ++in.pos;
+               if( in.pos == in.end ) refresh( w );
+               else                   update( w );
+            }
+            publish( pos );
+
+            // progressive backoff while waiting on an idle input
+            if( pos != start )       spin = 0;
+            else if( ++spin < 10000 ) continue;
+            else if( spin < 20000 )  usleep(0);
+            else                     usleep( 10*1000 );
+         }
+      }
+
+      /** publishes the output up to pos and the progress of every input */
+      void publish( int64_t pos )
+      {
+         if( pos <= _out_cursor->begin() ) return;
+         _out_cursor->publish( pos - 1 );
+         for( auto itr = _inputs.begin(); itr != _inputs.end(); ++itr )
+            if( itr->pos > itr->cur->begin() ) itr->cur->publish( itr->pos - 1 );
+      }
+
+      /**
+       *  Checks an input that ran out of events.
+       *  @return true if the key of input i changed
+       */
+      bool refresh( uint32_t i )
+      {
+         input& in = _inputs[i];
+         try
+         {
+            in.end = in.cur->try_wait_for( in.pos );
+         }
+         catch ( const eof& )
+         {
+            _keys[i] = key{ 0x7fffffffffffffff, done };
+            replay( i );
+            return true;
+         }
+
+         if( in.pos < in.end )
+         {
+            auto newest = _ts( in.buf->at(in.end-1) );
+            if( newest > _newest ) _newest = newest;
+            update( i );
+            return true;
+         }
+
+         // compare unsigned so the distance from an unset bound cannot overflow
+         if( _newest > in.bound && uint64_t(_newest) - uint64_t(in.bound) > uint64_t(_lookahead) )
+         {
+            in.bound = _newest - _lookahead;
+            update( i );
+            return true;
+         }
+         if( _keys[i].st != idle ) update( i );
+         return false;
+      }
+
+      /** recomputes the key of input i and replays its path */
+      void update( uint32_t i )
+      {
+         input& in = _inputs[i];
+         if( in.pos < in.end )
+         {
+            in.bound = _ts( in.buf->at(in.pos) );
+            _keys[i] = key{ in.bound, ready };
+         }
+         else
+         {
+            _keys[i] = key{ in.bound, idle };
+         }
+         replay( i );
+      }
+
+      /**
+       *  Moves leaf i up to the root, leaving the loser of each match in
+       *  the node where it was played.  _tree[0] holds the overall winner.
+       */
+      void replay( uint32_t i )
+      {
+         uint32_t winner = i;
+         for( uint32_t node = (i + _leaves) >> 1; node > 0; node >>= 1 )
+         {
+            if( _keys[_tree[node]] < _keys[winner] )
+               std::swap( _tree[node], winner );
+         }
+         _tree[0] = winner;
+      }
+
+      /** pads the inputs to a power of 2 with finished leaves and plays every match */
+      void build()
+      {
+         assert( _inputs.size() > 0 );
+         _leaves = 1;
+         while( _leaves < _inputs.size() ) _leaves <<= 1;
+
+         _keys.assign( _leaves, key{ 0x7fffffffffffffff, done } );
+         for( uint32_t i = 0; i < _inputs.size(); ++i )
+            _keys[i] = key{ _inputs[i].bound, idle };
+
+         // winners[n] is the winner below node n, leaves live at _leaves + i
+         std::vector<uint32_t> winners( 2*_leaves );
+         _tree.assign( _leaves, 0 );
+         for( uint32_t i = 0; i < _leaves; ++i ) winners[_leaves+i] = i;
+         for( uint32_t n = _leaves - 1; n > 0; --n )
+         {
+            auto l = winners[2*n];
+            auto r = winners[2*n+1];
+            if( _keys[r] < _keys[l] ) { winners[n] = r; _tree[n] = l; }
+            else                      { winners[n] = l; _tree[n] = r; }
+         }
+         _tree[0] = winners[1];
+         if( _leaves == 1 ) _tree[0] = 0;
+
+         for( uint32_t i = 0; i < _inputs.size(); ++i )
+            refresh( i );
+      }
+
+      std::shared_ptr<OutputBuffer>  _out;
+      write_cursor_ptr               _out_cursor;
+      const int64_t                  _lookahead;
+      const int64_t                  _max_batch;
+      /** the newest timestamp available on any input */
+      int64_t                        _newest;
+      Timestamp                      _ts;
+      std::vector<input>             _inputs;
+      uint32_t                       _leaves;
+      std::vector<key>               _keys;
+      std::vector<uint32_t>          _tree;
+};
+
+} // namespace disruptor
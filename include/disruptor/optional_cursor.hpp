@@ -0,0 +1,148 @@
+#pragma once
+#include "disruptor.hpp"
+
+namespace disruptor
+{
+
+/**
+ *  A reader that is not allowed to slow down its writer, such as an
+ *  analytics or logging consumer.
+ *
+ *  An optional_cursor either does not gate its writer at all or gates it
+ *  only while it is within lag_limit events of it.  Once it falls further
+ *  behind, the writer cuts it loose and the reader skips ahead to the
+ *  writer's current position the next time it calls wait_for(), counting
+ *  the skip and the events it missed.  A gating reader then rejoins its
+ *  writer with the same lag limit.
+ *
+ *  Because the writer does not wait for it, the events a reader is
+ *  processing may be overwritten underneath it.  After reading a batch,
+ *  valid() tells whether the batch was still intact.  This assumes the
+ *  writer publishes events as it writes them.
+ *
+ *  @code
+      auto r = std::make_shared<optional_cursor>( "analytics", p, 512 );
+      r->attach();
+
+      auto pos = r->begin();
+      auto end = r->end();
+      while( true )
+      {
+         if( pos == end )
+         {
+            r->publish(pos-1);
+            end = r->wait_for(end);
+            pos = r->begin();   // may have skipped ahead
+         }
+         auto e = source->at(pos);
+         if( r->valid(pos) ) record( e );
+         ++pos;
+      }
+ *  @endcode
+ */
+class optional_cursor : public read_cursor,
+                        public std::enable_shared_from_this<optional_cursor>
+{
+   public:
+      enum { non_gating = -1 };
+
+      /**
+       *  @param lag_limit - how far behind source this reader may fall before
+       *                     it is cut loose, or non_gating if the reader never
+       *                     holds source back.  A limit beyond the size of 
+       *                     source's ring would make source wait rather than 
+       *                     lap the reader, so it is clamped to the size.
+       */
+      optional_cursor( const char* n, write_cursor_ptr source, int64_t lag_limit = non_gating )
+      :read_cursor(n),_source(std::move(source)),
+       _lag_limit( lag_limit == non_gating ? lag_limit : std::min( lag_limit, _source->size() ) ),
+       _laps_seen(0),_skips(0),_skipped(0)
+      {
+         assert( lag_limit == non_gating || lag_limit >= 0 );
+      }
+
+      /**
+       *  Starts reading the source from its current position, this may be
+       *  called while the source is running.
+       */
+      void attach()
+      {
+         follows( _source );
+         join();
+      }
+
+      /** stops gating the source */
+      void detach()
+      {
+         _source->unfollow( shared_from_this() );
+      }
+
+      /**
+       *  Skips ahead first if this reader was lapped.
+       *
+       *  @return end() which is > begin()
+       */
+      int64_t wait_for( int64_t pos )
+      {
+         if( lapped_since_wait() )
+         {
+            skip_ahead();
+            pos = _begin;
+         }
+         return read_cursor::wait_for( pos );
+      }
+
+      /**
+       *  @return true if the event at pos and after has not been overwritten
+       *          yet, check after reading it.
+       */
+      bool valid( int64_t pos )const
+      {
+         return _source->pos().aquire() + 1 < pos + _source->size();
+      }
+
+      /** @return the number of times this reader skipped ahead */
+      uint64_t skips()const   { return _skips.load( std::memory_order_relaxed ); }
+
+      /** @return the number of events this reader has skipped */
+      uint64_t skipped()const { return _skipped.load( std::memory_order_relaxed ); }
+
+   private:
+      bool lapped_since_wait()const
+      {
+         if( _lag_limit == non_gating ) return !valid( _begin );
+         return laps() != _laps_seen;
+      }
+
+      void skip_ahead()
+      {
+         auto from = _begin;
+         _laps_seen = laps();
+         join();
+         _skips.fetch_add( 1, std::memory_order_relaxed );
+         _skipped.fetch_add( _begin - from, std::memory_order_relaxed );
+      }
+
+      /** 
+       *  Moves to the current position of the source and gates it again,
+       *  registering first like attach() so that the source cannot run
+       *  past the position picked before it sees this reader.
+       */
+      void join()
+      {
+         start_at( _source->pos().aquire() );
+         if( _lag_limit == non_gating ) return;
+         _source->follows( shared_from_this(), _lag_limit );
+         start_at( _source->pos().aquire() );
+      }
+
+      write_cursor_ptr         _source;
+      const int64_t            _lag_limit;
+      uint32_t                 _laps_seen;
+      std::atomic<uint64_t>    _skips;
+      std::atomic<uint64_t>    _skipped;
+};
+
+typedef std::shared_ptr<optional_cursor> optional_cursor_ptr;
+
+} // namespace disruptor
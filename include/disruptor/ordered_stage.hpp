@@ -0,0 +1,104 @@
+#pragma once
+#include "work_pool.hpp"
+
+namespace disruptor
+{
+
+class ordered_stage;
+typedef basic_work_cursor<ordered_stage>  ordered_cursor;
+typedef std::shared_ptr<ordered_cursor>   ordered_cursor_ptr;
+
+/**
+ *  A stage whose workers complete events out of order but whose output
+ *  becomes visible in sequence order.  Workers claim batches from a shared
+ *  work sequence like the workers of a work_pool and write their results
+ *  to the stage's output ring at the same position they read from.
+ *
+ *  Completed batches are recorded in a reorder buffer with one slot per
+ *  position of the ring holding the end of the batch that starts there.
+ *  The stage position is advanced over contiguous completed batches by
+ *  whichever worker closes a gap, so it costs a few loads per batch no
+ *  matter how many workers the stage has.
+ *
+ *  From the outside the stage is a single event_cursor.
+ *
+ *  @code
+      auto p     = std::make_shared<write_cursor>("write",SIZE);
+      auto stage = std::make_shared<ordered_stage>("transform", 4, SIZE, 16 );
+      auto c     = std::make_shared<read_cursor>("c");
+
+      stage->follows(p);
+      c->follows(stage);
+      p->follows(c);
+
+      // worker i
+      auto w = stage->worker(i);
+      while( true )
+      {
+         auto end = w->wait_next();
+         for( auto pos = w->begin(); pos < end; ++pos )
+            output->at(pos) = transform( input->at(pos) );
+         w->publish( end - 1 );
+      }
+ *  @endcode
+ */
+class ordered_stage : public cursor_group<ordered_cursor>
+{
+   public:
+      /**
+       *  @param s - the size of the ring buffers, batch_size must
+       *             be smaller.
+       */
+      ordered_stage( const char* n, uint32_t num_workers, int64_t s, int64_t batch_size = 1 )
+      :cursor_group<ordered_cursor>(n),_batch_size(batch_size),_size_m1(s-1),
+       _completed( new std::atomic<int64_t>[s] )
+      {
+         assert( num_workers > 0 && batch_size > 0 && batch_size < s );
+         assert( ((s != 0) && ((s & (~s + 1)) == s)) && "size must be a power of 2" );
+         for( int64_t i = 0; i < s; ++i ) 
+            _completed[i].store( -1, std::memory_order_relaxed );
+         _work.store(-1);
+         for( uint32_t i = 0; i < num_workers; ++i )
+            _members.push_back( std::make_shared<ordered_cursor>( *this, n ) );
+      }
+
+      const ordered_cursor_ptr& worker( uint32_t i )const { return _members[i]; }
+      uint32_t                  size()const               { return _members.size(); }
+
+   private:
+      friend class basic_work_cursor<ordered_stage>;
+
+      /** records [first,last] complete and moves the stage forward if possible */
+      void completed( int64_t first, int64_t last )
+      {
+         // sequentially consistent so that of two workers completing
+         // neighbouring batches at least one sees the other's batch.
+         _completed[first & _size_m1].store( last + 1 );
+         advance();
+      }
+
+      void advance()
+      {
+         auto cur = _cursor.aquire();
+         while( true )
+         {
+            auto next = cur + 1;
+            auto end  = _completed[next & _size_m1].load();
+            // anything else is left over from the previous lap or, if 
+            // cur is stale, already from the next one.
+            if( end <= next || end > next + _batch_size ) break;
+            cur = end - 1;
+         }
+         if( _cursor.store_max( cur ) ) notify();
+      }
+
+      const int64_t                             _batch_size;
+      const int64_t                             _size_m1;
+      std::unique_ptr<std::atomic<int64_t>[]>   _completed;
+      /** the last slot claimed by any worker */
+      sequence                                  _work;
+};
+
+typedef std::shared_ptr<ordered_stage> ordered_stage_ptr;
+
+} // namespace disruptor
@@ -0,0 +1,144 @@
+#pragma once
+#include "cursor_group.hpp"
+
+namespace disruptor
+{
+
+class partition_group;
+
+/**
+ *  One shard of a partition_group.  Every shard follows the same
+ *  source but only processes the slots whose key maps to it, so
+ *  per-key state can be kept by a single thread without locks.
+ *
+ *  Ownership is looked up in the group's key column rather than in the
+ *  events themselves so skipping a slot never touches its payload.
+ *
+ *  @code
+     auto s   = group->shard(i);
+     auto pos = s->begin();
+     auto end = s->end();
+     while( true )
+     {
+        if( pos == end )
+        {
+            s->publish(pos-1);
+            end = s->wait_for(end);
+        }
+        pos = s->next( pos, end );
+        if( pos == end ) continue;
+        state[ source->at(pos).key ] += source->at(pos).value;
+        ++pos;
+     }
+ *  @endcode
+ */
+class partition_cursor : public read_cursor
+{
+   public:
+      partition_cursor( partition_group& g, const char* n, uint16_t shard )
+      :read_cursor(n),_group(g),_shard(shard)
+      {
+         _cursor.store(-1);
+      }
+
+      /** @return the first slot in [pos,end) owned by this shard or end */
+      inline int64_t next( int64_t pos, int64_t end )const;
+
+      /** @return end() which is > pos */
+      inline int64_t wait_for( int64_t pos );
+
+      /** marks everything up to p handled and updates the group position */
+      inline void publish( int64_t p );
+
+      uint16_t shard()const { return _shard; }
+
+   private:
+      partition_group&  _group;
+      const uint16_t    _shard;
+};
+
+typedef std::shared_ptr<partition_cursor> partition_cursor_ptr;
+
+/**
+ *  Splits a stream by key over a fixed number of shards.  The producer
+ *  records the key of each slot with set_key() before publishing it and
+ *  the group stores the owning shard in a compact column alongside the
+ *  ring buffer.  Shards scan that column, a couple of bytes per slot,
+ *  instead of every event.
+ *
+ *  Like a work_pool, the group is a single cursor whose position is the
+ *  min of its shards so the producer and later stages can follow it.
+ *
+ *  @code
+      auto p     = std::make_shared<write_cursor>("write",SIZE);
+      auto group = std::make_shared<partition_group>("shards", 8, SIZE );
+
+      group->follows(p);
+      p->follows(group);
+
+      // publisher
+      source->at(pos) = e;
+      group->set_key( pos, std::hash<uint64_t>()(e.key) );
+      p->publish(pos);
+ *  @endcode
+ */
+class partition_group : public cursor_group<partition_cursor>
+{
+   public:
+      /**
+       *  @param s - the size of the ring buffer being partitioned
+       */
+      partition_group( const char* n, uint16_t num_shards, int64_t s )
+      :cursor_group<partition_cursor>(n),_keys(s),_size_m1(s-1)
+      {
+         assert( num_shards > 0 );
+         assert( ((s != 0) && ((s & (~s + 1)) == s)) && "size must be a power of 2" );
+         for( uint16_t i = 0; i < num_shards; ++i )
+            _members.push_back( std::make_shared<partition_cursor>( *this, n, i ) );
+      }
+
+      /** called by the producer before publishing pos */
+      void set_key( int64_t pos, uint64_t key_hash )
+      {
+         _keys[pos & _size_m1] = key_hash % _members.size();
+      }
+
+      /** @return the shard that owns pos */
+      uint16_t shard_of( int64_t pos )const { return _keys[pos & _size_m1]; }
+
+      const partition_cursor_ptr& shard( uint16_t i )const { return _members[i]; }
+      uint16_t                    size()const              { return _members.size(); }
+
+   private:
+      friend class partition_cursor;
+
+      std::vector<uint16_t>  _keys;
+      const int64_t          _size_m1;
+};
+
+typedef std::shared_ptr<partition_group> partition_group_ptr;
+
+
+inline int64_t partition_cursor::next( int64_t pos, int64_t end )const
+{
+   while( pos < end && _group.shard_of(pos) != _shard ) ++pos;
+   return pos;
+}
+
+inline int64_t partition_cursor::wait_for( int64_t pos )
+{
+   try
+   {
+      return read_cursor::wait_for( pos );
+   }
+   catch ( const eof& ) { _group.member_eof( *this ); throw; }
+   catch ( ... ) { _group.member_alert( std::current_exception() ); throw; }
+}
+
+inline void partition_cursor::publish( int64_t p )
+{
+   read_cursor::publish( p );
+   _group.update();
+}
+
+} // namespace disruptor
@@ -0,0 +1,117 @@
+#pragma once
+#include "thread.hpp"
+#include <memory>
+#include <vector>
+
+namespace disruptor
+{
+
+/**
+ *  One disruptor::thread per core, each pinned to its own cpu, connected
+ *  by a mesh of single producer mailboxes.
+ *
+ *  Every ordered pair of cores, including a core and itself, has a
+ *  mailbox: a ring of posted functors with a plain write_cursor that only
+ *  the sending core writes and a read_cursor served by the receiving
+ *  core.  A send() between cores is an uncontended write and a publish,
+ *  where atomic_post() has every sender contend for the claim sequence of
+ *  the receiver's one post ring.  The receivers only check the mailboxes
+ *  that rang their bell, so an idle mesh costs nothing to serve.
+ *
+ *  Threads that are not cores of the runtime, and so have no mailboxes,
+ *  fall back to atomic_post().
+ *
+ *  Like atomic_post(), send() waits while the mailbox is full.  A core
+ *  must not send more than mailbox_size messages to itself from one
+ *  functor, and cores that flood each other should bound the messages
+ *  they have in flight.
+ *
+ *  @code
+     runtime rt(4);
+     rt.start();
+     rt.route( account_id, [=]() { apply( account_id, amount ); } );
+ *  @endcode
+ */
+class runtime
+{
+   public:
+      enum { mailbox_size = 256 };
+
+      /**
+       *  @param cores - how many threads to run, when started each is
+       *                 pinned to a cpu chosen by cpu_topology::place().
+       */
+      explicit runtime( uint32_t cores );
+      ~runtime();
+
+      uint32_t size()const { return uint32_t(_cores.size()); }
+
+      /** the thread of core i, for adding cursors, fds and timers */
+      thread&  core( uint32_t i ) { return *_cores[i]; }
+
+      /** @return the core the caller is running on or -1 if it is not one of ours */
+      int32_t  current()const { return _current_runtime == this ? _current_core : -1; }
+
+      /** calls f on core to, see the class comment */
+      template<typename Functor>
+      void send( uint32_t to, Functor&& f )
+      {
+         int32_t from = current();
+         if( from < 0 )
+         {
+            _cores[to]->atomic_post( std::forward<Functor>(f) );
+            return;
+         }
+         mailbox& m = *_mail[from * size() + to];
+         if( m.pos >= m.end ) m.end = m.write->wait_for( m.pos );
+         m.buffer.at(m.pos).assign( std::forward<Functor>(f) );
+         m.write->publish( m.pos++ );
+      }
+
+      /**
+       *  @return the core that owns key, so that state kept per key is only
+       *          touched by one thread
+       */
+      template<typename Key>
+      uint32_t shard_of( const Key& k )const { return std::hash<Key>()(k) % size(); }
+
+      /** calls f on the core that owns key */
+      template<typename Key, typename Functor>
+      void route( const Key& k, Functor&& f ) { send( shard_of(k), std::forward<Functor>(f) ); }
+
+      void start();
+      void stop();
+      void join();
+
+   private:
+      struct mailbox
+      {
+         mailbox():write( std::make_shared<write_cursor>( "mailbox", mailbox_size ) ),
+                   read( std::make_shared<read_cursor>( "mailbox" ) )
+         {
+            read->follows( write );
+            write->follows( read );
+            // nothing is read yet, or the sender could wrap onto slot 0
+            read->start_at( -1 );
+            pos = write->begin();
+            end = write->end();
+         }
+
+         write_cursor_ptr                     write;
+         read_cursor_ptr                      read;
+         ring_buffer<detail::functor,mailbox_size> buffer;
+         /** owned by the sending core */
+         int64_t                              pos;
+         int64_t                              end;
+      };
+
+      static thread_local const runtime*      _current_runtime;
+      static thread_local int32_t             _current_core;
+
+      /** _mail[from * size() + to], destroyed after the cores serving them */
+      std::vector<std::unique_ptr<mailbox>>   _mail;
+      std::vector<std::unique_ptr<thread>>    _cores;
+      bool                                    _running;
+};
+
+} // namespace disruptor
@@ -0,0 +1,183 @@
+#pragma once
+#include "disruptor.hpp"
+
+namespace disruptor
+{
+
+class spsc_read_cursor;
+
+/**
+ *  The write side of a single producer, single consumer pair.
+ *
+ *  The general cursors go through a barrier that walks a vector of
+ *  shared pointers, check for alerts on every publish and handle errors
+ *  with exceptions.  When one producer feeds exactly one consumer none
+ *  of that is needed: each side keeps a local copy of how far it may go
+ *  and only reads the other side's position once that copy is exhausted,
+ *  so in steady state neither side touches the other's cache line more
+ *  than once per batch.
+ *
+ *  Positions follow the usual convention, pos() is the last published
+ *  event and [begin(),end()) is the range that may be written without
+ *  waiting.
+ *
+ *  @code
+      spsc_write_cursor w(SIZE);
+      spsc_read_cursor  r(w);
+
+      // producer
+      auto pos = w.begin();
+      auto end = w.end();
+      for( uint64_t i = 0; i < iterations; ++i )
+      {
+         if( pos >= end ) end = w.wait_for(pos);
+         buffer->at(pos) = i;
+         w.publish(pos);
+         ++pos;
+      }
+      w.set_eof();
+ *  @endcode
+ */
+class spsc_write_cursor
+{
+   public:
+      /** @param s - the size of the ring buffer */
+      spsc_write_cursor( int64_t s )
+      :_cursor(-1),_begin(0),_end(s),_size(s),_reader(nullptr){}
+
+      int64_t begin()const { return _begin; }
+      int64_t end()const   { return _end;   }
+
+      /** makes the event at p available to the reader */
+      void publish( int64_t p )
+      {
+         _begin = p + 1;
+         _cursor.store( p );
+      }
+
+      /** waits until pos may be written without lapping the reader.
+       *  @return end() which is > pos */
+      inline int64_t wait_for( int64_t pos );
+
+      /** refreshes end() from the reader's position without blocking */
+      int64_t check_end() { return _end = _reader->aquire() + _size + 1; }
+
+      /** once the reader has consumed everything published it gets eof */
+      void set_eof() { _cursor.set_eof(); }
+
+      const sequence& pos()const { return _cursor; }
+
+   private:
+      friend class spsc_read_cursor;
+
+      sequence          _cursor;
+      int64_t           _begin;
+      int64_t           _end;
+      const int64_t     _size;
+      const sequence*   _reader;
+};
+
+/**
+ *  The read side of a single producer, single consumer pair.
+ *
+ *  @code
+      auto pos = r.begin();
+      auto end = r.end();
+      while( true )
+      {
+         if( pos == end )
+         {
+            r.publish(pos-1);
+            end = r.wait_for(pos);
+         }
+         process( buffer->at(pos) );
+         ++pos;
+      }
+ *  @endcode
+ */
+class spsc_read_cursor
+{
+   public:
+      spsc_read_cursor( spsc_write_cursor& w )
+      :_cursor(-1),_begin(0),_end(0),_writer(&w._cursor)
+      {
+         w._reader = &_cursor;
+      }
+
+      int64_t begin()const { return _begin; }
+      int64_t end()const   { return _end;   }
+
+      /** releases everything up to p back to the writer */
+      void publish( int64_t p )
+      {
+         _begin = p + 1;
+         _cursor.store( p );
+      }
+
+      /**
+       *  Waits until the event at pos has been published.
+       *
+       *  @return end() which is > pos
+       *  @throw  eof if the writer set eof before publishing pos
+       */
+      inline int64_t wait_for( int64_t pos );
+
+      /** refreshes end() from the writer's position without blocking */
+      int64_t check_end() { return _end = _writer->aquire() + 1; }
+
+      const sequence& pos()const { return _cursor; }
+
+   private:
+      sequence          _cursor;
+      int64_t           _begin;
+      int64_t           _end;
+      const sequence*   _writer;
+};
+
+namespace detail
+{
+   /**
+    *  The same progressive backoff used by barrier::wait_for(), waits
+    *  until seq reaches pos or, if stop_on_eof, until seq is at eof.
+    *
+    *  @return the last value read from seq
+    */
+   inline int64_t spsc_wait( const sequence& seq, int64_t pos, bool stop_on_eof )
+   {
+      int64_t seq_pos = seq.aquire();
+      for( int i = 0; seq_pos < pos && i < 10000; ++i  )
+      {
+         seq_pos = seq.aquire();
+         if( stop_on_eof && seq.eof() ) return seq.aquire();
+      }
+      for( int y = 0; seq_pos < pos && y < 10000; ++y )
+      {
+         usleep(0);
+         seq_pos = seq.aquire();
+         if( stop_on_eof && seq.eof() ) return seq.aquire();
+      }
+      while( seq_pos < pos )
+      {
+         usleep( 10*1000 );
+         seq_pos = seq.aquire();
+         if( stop_on_eof && seq.eof() ) return seq.aquire();
+      }
+      return seq_pos;
+   }
+}
+
+inline int64_t spsc_write_cursor::wait_for( int64_t pos )
+{
+   if( pos < _end ) return _end;
+   return _end = detail::spsc_wait( *_reader, pos - _size, false ) + _size + 1;
+}
+
+inline int64_t spsc_read_cursor::wait_for( int64_t pos )
+{
+   if( pos < _end ) return _end;
+   _end = detail::spsc_wait( *_writer, pos, true ) + 1;
+   if( _end <= pos ) throw eof();
+   return _end;
+}
+
+} // namespace disruptor
@@ -0,0 +1,321 @@
+#pragma once
+#include "disruptor.hpp"
+#include <tuple>
+#include <type_traits>
+
+namespace disruptor
+{
+
+namespace detail
+{
+   template<uint32_t I>
+   struct unrolled
+   {
+      static int64_t min( const sequence* const* s ) { return std::min( s[I-1]->aquire(), unrolled<I-1>::min(s) ); }
+      static bool    ended( const sequence* const* s, int64_t pos ) { return (s[I-1]->eof() && s[I-1]->aquire() < pos) || unrolled<I-1>::ended(s,pos); }
+   };
+
+   template<>
+   struct unrolled<1>
+   {
+      static int64_t min( const sequence* const* s ) { return s[0]->aquire(); }
+      /** true if s[0] set eof short of pos, eof is set after the last publish so the flag is read first */
+      static bool    ended( const sequence* const* s, int64_t pos ) { return s[0]->eof() && s[0]->aquire() < pos; }
+   };
+}
+
+/**
+ *  A barrier over a fixed number of sequences known at compile time.
+ *  Unlike barrier there is no vector to walk, the min of the N
+ *  sequences is computed by a fully unrolled expression.
+ *
+ *  Uses the same progressive backoff as barrier.
+ */
+template<uint32_t N>
+class static_barrier
+{
+   public:
+      static_assert( N > 0, "a static barrier must follow at least one cursor" );
+
+      static_barrier():_last_min(-1){ std::fill( _limit_seq, _limit_seq + N, nullptr ); }
+
+      /** sets the i'th sequence waited on */
+      void follows( uint32_t i, const sequence& s ) { _limit_seq[i] = &s; }
+
+      /** @return the min position of every sequence this barrier follows */
+      int64_t get_min() { return _last_min = detail::unrolled<N>::min( _limit_seq ); }
+
+      /**
+       *  Waits until every sequence is >= pos.
+       *
+       *  @return the minimum value of every dependency
+       *  @throw  eof if a sequence set eof before reaching pos, a sequence
+       *          that ended past pos does not hold anyone back
+       */
+      int64_t wait_for( int64_t pos )
+      {
+         if( _last_min >= pos )
+            return _last_min;
+
+         int64_t min_pos = get_min();
+         for( int i = 0; min_pos < pos && i < 10000; ++i  )
+         {
+            if( detail::unrolled<N>::ended( _limit_seq, pos ) ) throw eof();
+            min_pos = get_min();
+         }
+         for( int y = 0; min_pos < pos && y < 10000; ++y )
+         {
+            if( detail::unrolled<N>::ended( _limit_seq, pos ) ) throw eof();
+            usleep(0);
+            min_pos = get_min();
+         }
+         while( min_pos < pos )
+         {
+            if( detail::unrolled<N>::ended( _limit_seq, pos ) ) throw eof();
+            usleep( 10*1000 );
+            min_pos = get_min();
+         }
+         return min_pos;
+      }
+
+   private:
+      int64_t           _last_min;
+      const sequence*   _limit_seq[N];
+};
+
+/**
+ *  A read cursor that follows exactly N cursors, fixed at compile time.
+ *  It is used like read_cursor but is wired up by a static_topology.
+ */
+template<uint32_t N>
+class static_read_cursor
+{
+   public:
+      static_read_cursor():_begin(0),_end(0),_cursor(-1){}
+
+      int64_t begin()const { return _begin; }
+      int64_t end()const   { return _end;   }
+
+      void publish( int64_t p )
+      {
+         _begin = p + 1;
+         _cursor.store( p );
+      }
+
+      /** @return end() which is > pos */
+      int64_t wait_for( int64_t pos )
+      {
+         try {
+            return _end = _barrier.wait_for(pos) + 1;
+         }
+         catch ( const eof& ) { _cursor.set_eof(); throw; }
+      }
+
+      int64_t check_end() { return _end = _barrier.get_min() + 1; }
+
+      void set_eof() { _cursor.set_eof(); }
+
+      const sequence&     pos()const { return _cursor;  }
+      static_barrier<N>&  barrier()  { return _barrier; }
+
+   private:
+      int64_t             _begin;
+      int64_t             _end;
+      static_barrier<N>   _barrier;
+      sequence            _cursor;
+};
+
+/**
+ *  A write cursor gated by exactly N cursors, fixed at compile time,
+ *  for a ring buffer of Size.
+ */
+template<uint32_t N, int64_t Size>
+class static_write_cursor
+{
+   public:
+      static_write_cursor():_begin(0),_end(Size),_cursor(-1){}
+
+      int64_t begin()const { return _begin; }
+      int64_t end()const   { return _end;   }
+
+      void publish( int64_t p )
+      {
+         _begin = p + 1;
+         _cursor.store( p );
+      }
+
+      /** waits until pos may be written without lapping any reader */
+      int64_t wait_for( int64_t pos ) { return _end = _barrier.wait_for( pos - Size ) + Size; }
+
+      int64_t check_end() { return _end = _barrier.get_min() + Size; }
+
+      void set_eof() { _cursor.set_eof(); }
+
+      const sequence&     pos()const { return _cursor;  }
+      static_barrier<N>&  barrier()  { return _barrier; }
+
+   private:
+      int64_t             _begin;
+      int64_t             _end;
+      static_barrier<N>   _barrier;
+      sequence            _cursor;
+};
+
+template<typename... Tags> struct type_list {};
+
+/**
+ *  Declares the writer of a static_topology, Tag names it and GatedBy
+ *  names the readers it must not lap.
+ */
+template<typename Tag, typename... GatedBy>
+struct writer
+{
+   static_assert( sizeof...(GatedBy) > 0, "the writer must be gated by at least one reader" );
+
+   typedef Tag                    tag;
+   typedef type_list<GatedBy...>  deps;
+   /** gating edges point downstream so they are not walked looking for readers */
+   typedef type_list<>            upstream;
+
+   template<int64_t Size>
+   struct cursor { typedef static_write_cursor<sizeof...(GatedBy),Size> type; };
+};
+
+/**
+ *  Declares a reader of a static_topology, Tag names it and Follows
+ *  names the cursors it reads behind.
+ */
+template<typename Tag, typename... Follows>
+struct reader
+{
+   static_assert( sizeof...(Follows) > 0, "a reader must follow at least one cursor" );
+
+   typedef Tag                    tag;
+   typedef type_list<Follows...>  deps;
+   typedef type_list<Follows...>  upstream;
+
+   template<int64_t Size>
+   struct cursor { typedef static_read_cursor<sizeof...(Follows)> type; };
+};
+
+namespace detail
+{
+   template<typename T> struct always_false : std::false_type {};
+
+   template<typename I> struct plus_one : std::integral_constant<uint32_t, I::value + 1> {};
+
+   template<typename Tag, typename... Nodes> struct index_of;
+
+   template<typename Tag>
+   struct index_of<Tag> : std::integral_constant<uint32_t,0>
+   {
+      static_assert( always_false<Tag>::value, "cursor is not declared in the topology" );
+   };
+
+   template<typename Tag, typename Node, typename... Nodes>
+   struct index_of<Tag,Node,Nodes...>
+      : std::conditional< std::is_same<Tag,typename Node::tag>::value,
+                          std::integral_constant<uint32_t,0>,
+                          plus_one< index_of<Tag,Nodes...> > >::type {};
+
+   template<typename Tag, typename... Nodes>
+   struct node_of : std::tuple_element< index_of<Tag,Nodes...>::value, std::tuple<Nodes...> > {};
+
+   template<typename Target, typename List, typename... Nodes> struct any_reaches;
+
+   /** true if From is Target or reads, directly or not, behind Target */
+   template<typename From, typename Target, typename... Nodes>
+   struct reaches
+      : std::conditional< std::is_same<From,Target>::value,
+                          std::true_type,
+                          any_reaches<Target, typename node_of<From,Nodes...>::type::upstream, Nodes...> >::type {};
+
+   template<typename Target, typename... Nodes>
+   struct any_reaches<Target, type_list<>, Nodes...> : std::false_type {};
+
+   template<typename Target, typename From, typename... Froms, typename... Nodes>
+   struct any_reaches<Target, type_list<From,Froms...>, Nodes...>
+      : std::conditional< reaches<From,Target,Nodes...>::value,
+                          std::true_type,
+                          any_reaches<Target, type_list<Froms...>, Nodes...> >::type {};
+
+   /** every reader must hold back the writer, directly or through a reader behind it */
+   template<typename Writer, typename... Nodes>
+   struct check_gating;
+
+   template<typename Writer, typename... Nodes>
+   struct check_gating<Writer, type_list<>, Nodes...> : std::true_type {};
+
+   template<typename Writer, typename Reader, typename... Readers, typename... Nodes>
+   struct check_gating<Writer, type_list<Reader,Readers...>, Nodes...>
+      : check_gating<Writer, type_list<Readers...>, Nodes...>
+   {
+      static_assert( any_reaches<typename Reader::tag, typename Writer::deps, Nodes...>::value,
+                     "a reader is not gating the writer, the writer could lap it" );
+   };
+}
+
+/**
+ *  A pipeline whose shape is fixed at compile time.  Each cursor is
+ *  declared once with the cursors it depends on and gets a barrier over
+ *  exactly that many sequences, so waiting never walks a vector or
+ *  follows a shared_ptr.
+ *
+ *  Mistakes in the shape are compile errors: depending on a cursor that
+ *  is not declared, a reader that follows nothing, or a reader that the
+ *  writer could lap because neither it nor anything behind it gates the
+ *  writer.
+ *
+ *  @code
+      struct P; struct A; struct B; struct C;
+      typedef static_topology< 1024,
+                               writer<P, C>,
+                               reader<A, P>,
+                               reader<B, P>,
+                               reader<C, A, B> > diamond;
+      diamond d;
+      auto& p = d.get<P>();
+      auto& c = d.get<C>();
+ *  @endcode
+ */
+template<int64_t Size, typename Writer, typename... Readers>
+class static_topology
+{
+   public:
+      static_assert( ((Size != 0) && ((Size & (~Size + 1)) == Size)), "size must be a power of 2" );
+      static_assert( detail::check_gating<Writer, type_list<Readers...>, Writer, Readers...>::value, "" );
+
+      template<typename Tag>
+      struct cursor_of
+      {
+         typedef typename detail::node_of<Tag,Writer,Readers...>::type::template cursor<Size>::type type;
+      };
+
+      static_topology()
+      {
+         int wired[] = { (wire<Writer>( typename Writer::deps() ), 0),
+                         (wire<Readers>( typename Readers::deps() ), 0)... };
+         (void)wired;
+      }
+
+      template<typename Tag>
+      typename cursor_of<Tag>::type& get()
+      {
+         return std::get< detail::index_of<Tag,Writer,Readers...>::value >( _cursors );
+      }
+
+   private:
+      template<typename Node, typename... Deps>
+      void wire( type_list<Deps...> )
+      {
+         auto&    c     = get<typename Node::tag>();
+         uint32_t i     = 0;
+         int      dummy[] = { (c.barrier().follows( i++, get<Deps>().pos() ), 0)... };
+         (void)dummy;
+      }
+
+      std::tuple< typename Writer::template cursor<Size>::type,
+                  typename Readers::template cursor<Size>::type... >  _cursors;
+};
+
+} // namespace disruptor
@@ -1,18 +1,82 @@
 #pragma once
 #include "disruptor.hpp"
+#include "future.hpp"
+#include "timer_wheel.hpp"
+#include <chrono>
+#include <functional>
+#include <type_traits>
+#include <sys/epoll.h>
 namespace disruptor
 {
    namespace detail
    {
-        struct functor
+        /**
+         *  A slot in the post ring.  Slots are one cache line, aligned so 
+         *  producers filling neighbouring slots never share a line, which
+         *  holds the closures most posts make, capturing a pointer or a few.
+         *  Larger closures spill into a buffer owned by the slot that is
+         *  kept for the next post through the same slot, growing in powers
+         *  of 2, so steady state posting does not allocate.  The slot is
+         *  only written by the poster that claimed it, so the spill buffer
+         *  needs no synchronization beyond the post cursor.
+         */
+        struct alignas(64) functor
         {
-            functor():callback(nullptr),destruct(nullptr){}
-            void call(){ callback( _buffer ); }
+            enum { inline_size = 32 };
+
+            functor():callback(nullptr),destruct(nullptr),_spill(nullptr),_spill_size(0),_spilled(false){}
+            ~functor(){ delete[] _spill; }
+
+            /** calls the posted functor and destroys it, even if it throws */
+            void call()
+            {
+                struct guard 
+                { 
+                   functor* f; 
+                   ~guard(){ f->destruct( f->data() ); } 
+                } g = { this };
+                callback( data() ); 
+            }
+
+            /** destroys the functor without calling it */
+            void destroy() { destruct( data() ); }
+
+            /** constructs f in this slot */
+            template<typename Functor>
+            void assign( Functor&& f );
 
             void (*callback)( void* self ); 
             void (*destruct)( void* self );
-            char _buffer[256];
+
+         private:
+            // slots stay in their ring, a copy would free the spill buffer twice
+            functor( const functor& ) = delete;
+            functor& operator=( const functor& ) = delete;
+
+            void* data() { return _spilled ? (void*)_spill : (void*)_buffer; }
+
+            void* reserve( uint32_t size )
+            {
+               _spilled = size > inline_size;
+               if( !_spilled ) return _buffer;
+               if( size > _spill_size )
+               {
+                  uint32_t s = 64;
+                  while( s < size ) s <<= 1;
+                  delete[] _spill;
+                  _spill      = new char[s];
+                  _spill_size = s;
+               }
+               return _spill;
+            }
+
+            char*                  _spill;
+            uint32_t               _spill_size;
+            bool                   _spilled;
+            alignas(16) char       _buffer[inline_size];
         };
+        static_assert( sizeof(functor) == 64, "a functor slot is one cache line" );
+
         template<typename Functor>
         struct functor_invoker
         {
@@ -25,6 +89,134 @@ namespace disruptor
                 ((Functor*)self)->~Functor();
             }
         };
+
+        template<typename Functor>
+        void functor::assign( Functor&& f )
+        {
+            typedef typename std::decay<Functor>::type F;
+            static_assert( std::alignment_of<F>::value <= 16, "Functors may not be aligned to more than 16 bytes" );
+
+            new (reserve( sizeof(F) )) F( std::forward<Functor>(f) );
+            callback = &functor_invoker<F>::run;
+            destruct = &functor_invoker<F>::destruct;
+        }
+
+        template<typename Handler>
+        struct handler_invoker
+        {
+            static int64_t run_inline( void* state, int64_t begin, int64_t end )
+            {
+                return (*((Handler*)state))( begin, end );
+            }
+            static int64_t run_heap( void* state, int64_t begin, int64_t end )
+            {
+                return (**((Handler**)state))( begin, end );
+            }
+            static void destroy( void* state )
+            {
+                delete *((Handler**)state);
+            }
+        };
+
+        /**
+         *  A cursor handler stored as a function pointer plus its state.
+         *
+         *  The function pointer is instantiated for the concrete handler
+         *  type, so the handler body is inlined into it and the run loop
+         *  makes one indirect call per batch.  Handlers that are small and
+         *  trivially copyable, such as lambdas that capture a few pointers,
+         *  live inline in the handler slot; anything else is allocated once
+         *  when it is registered.
+         */
+        class handler_ref
+        {
+           public:
+              /** an empty handler that must not be called */
+              handler_ref():_invoke(nullptr),_destroy(nullptr){}
+
+              template<typename Handler>
+              explicit handler_ref( Handler&& h )
+              {
+                 typedef typename std::decay<Handler>::type H;
+                 init<H>( std::forward<Handler>(h), 
+                          std::integral_constant<bool, sizeof(H) <= sizeof(_state) &&
+                                                       std::alignment_of<H>::value <= std::alignment_of<state>::value &&
+                                                       std::is_trivially_copyable<H>::value>() );
+              }
+
+              handler_ref( handler_ref&& r ) noexcept
+              :_invoke(r._invoke),_destroy(r._destroy),_state(r._state)
+              {
+                 r._destroy = nullptr;
+              }
+
+              handler_ref& operator=( handler_ref&& r ) noexcept
+              {
+                 if( this != &r )
+                 {
+                    if( _destroy ) _destroy( &_state );
+                    _invoke  = r._invoke;
+                    _destroy = r._destroy;
+                    _state   = r._state;
+                    r._destroy = nullptr;
+                 }
+                 return *this;
+              }
+
+              ~handler_ref() { if( _destroy ) _destroy( &_state ); }
+
+              int64_t operator()( int64_t begin, int64_t end ) { return _invoke( &_state, begin, end ); }
+
+              explicit operator bool()const { return _invoke != nullptr; }
+
+           private:
+              typedef typename std::aligned_storage<6*sizeof(void*)>::type state;
+
+              template<typename H, typename Handler>
+              void init( Handler&& h, std::true_type )
+              {
+                 new (&_state) H( std::forward<Handler>(h) );
+                 _invoke  = &handler_invoker<H>::run_inline;
+                 _destroy = nullptr;
+              }
+
+              template<typename H, typename Handler>
+              void init( Handler&& h, std::false_type )
+              {
+                 new (&_state) H*( new H( std::forward<Handler>(h) ) );
+                 _invoke  = &handler_invoker<H>::run_heap;
+                 _destroy = &handler_invoker<H>::destroy;
+              }
+
+              int64_t (*_invoke)( void* state, int64_t begin, int64_t end );
+              void    (*_destroy)( void* state );
+              state     _state;
+        };
+
+        /** adapts a void() callback to the handler_ref signature */
+        template<typename Callback>
+        struct void_handler
+        {
+            int64_t operator()( int64_t, int64_t )
+            {
+                c();
+                return 0;
+            }
+            Callback c;
+        };
+
+        /** adapts a handler of fd events to the handler_ref signature */
+        template<typename Handler>
+        struct fd_handler
+        {
+            int64_t operator()( int64_t fd, int64_t events )
+            {
+                h( int(fd), uint32_t(events) );
+                return 0;
+            }
+            Handler h;
+        };
+
         class thread_impl;
    }
 
@@ -48,6 +240,8 @@ namespace disruptor
          ~thread();
          
          /**
+          *  The signature of a cursor handler.
+          *
           *  Is passed the range [begin,end) to process and
           *  returns the first unprocessed element.  If all
           *  elements are processed then it should return end.
@@ -57,6 +251,9 @@ namespace disruptor
           *
           *  If N elements are processed then it should return
           *  begin + N
+          *
+          *  add_cursor() accepts any callable with this signature and
+          *  calls it without going through std::function.
           */
          typedef std::function< int64_t( int64_t, int64_t)> handler;
 
@@ -66,15 +263,8 @@ namespace disruptor
          template<typename Functor>
          void atomic_post( Functor&& f )
          {
-            static_assert( sizeof(f) < 256, "Functor's must be smaller than 256 bytes" );
-            int64_t          slot = post_cursor->claim(1);
-            detail::functor& func = post_buffer.at(slot);
-
-            // construct the functor inplace
-            new (func._buffer) Functor( std::forward<Functor>(f) );
-            func.callback = &detail::functor_invoker<Functor>::run;
-            func.destruct = &detail::functor_invoker<Functor>::destruct;
-
+            int64_t slot = post_cursor->claim(1);
+            post_buffer.at(slot).assign( std::forward<Functor>(f) );
             post_cursor->publish_after( slot, slot - 1 );
          }
 
@@ -86,29 +276,329 @@ namespace disruptor
          template<typename Functor>
          void post( Functor&& f )
          {
-            static_assert( sizeof(f) < 256, "Functor's must be smaller than 256 bytes" );
+            int64_t slot = post_cursor->wait_next();
+            post_buffer.at(slot).assign( std::forward<Functor>(f) );
+            post_cursor->publish(slot);
+         }
 
-            int64_t slot          = post_cursor->wait_next();
-            detail::functor& func = post_buffer.at(slot);
+         /** the most functors posted with one claim, larger bulk posts are split */
+         enum { max_bulk = 128 };
 
-            // construct the functor inplace
-            new (func._buffer) Functor( std::forward<Functor>(f) );
-            func.callback = &detail::functor_invoker<Functor>::run;
-            func.destruct = &detail::functor_invoker<Functor>::destruct;
-            
-            post_cursor->publish(slot);
+         /**
+          *  Posts make( i ) for i in [0,n) like n calls to atomic_post() but
+          *  claims and publishes up to max_bulk slots at a time, so many 
+          *  small tasks cost one contended claim rather than one each.  The
+          *  functors are constructed in their slots and become visible to
+          *  the thread together.
+          *
+          *  If make() throws, the slots already claimed are filled with 
+          *  functors that do nothing so that the ring is not blocked.
+          */
+         template<typename Generator>
+         void atomic_post_bulk( uint32_t n, Generator&& make )
+         {
+            for( uint32_t i = 0; i < n; )
+            {
+               uint32_t count = std::min<uint32_t>( n - i, max_bulk );
+               int64_t  first = post_cursor->claim( count );
+               fill( first, count, i, make, true );
+               post_cursor->publish_after( first + count - 1, first - 1 );
+            }
+         }
+
+         /** like atomic_post_bulk() for a single producer, see post() */
+         template<typename Generator>
+         void post_bulk( uint32_t n, Generator&& make )
+         {
+            for( uint32_t i = 0; i < n; )
+            {
+               uint32_t count = std::min<uint32_t>( n - i, max_bulk );
+               int64_t  first = post_cursor->begin();
+               // like claim( count ), which waits for one past the last slot
+               post_cursor->wait_for( first + count );
+               fill( first, count, i, make, false );
+               post_cursor->publish( first + count - 1 );
+            }
          }
 
+         /**
+          *  Posts go to one of two lanes, each with its own ring.  The high
+          *  lane is for control messages, such as cancels, that must not 
+          *  wait behind a backlog of bulk work: the thread drains it before
+          *  every batch of any cursor, including the normal post ring, so
+          *  a high post waits for at most one batch of bulk work.
+          */
+         enum priority { normal, high };
+
+         /** like atomic_post( f ) on the lane given by p */
+         template<typename Functor>
+         void atomic_post( priority p, Functor&& f )
+         {
+            if( p == normal ) return atomic_post( std::forward<Functor>(f) );
+            int64_t slot = high_post_cursor->claim(1);
+            high_post_buffer.at(slot).assign( std::forward<Functor>(f) );
+            high_post_cursor->publish_after( slot, slot - 1 );
+         }
 
-         void add_cursor( read_cursor_ptr c, handler h  );
+         /** 
+          *  Like post( f ) on the lane given by p, each lane has its own
+          *  single producer.
+          */
+         template<typename Functor>
+         void post( priority p, Functor&& f )
+         {
+            if( p == normal ) return post( std::forward<Functor>(f) );
+            int64_t slot = high_post_cursor->wait_next();
+            high_post_buffer.at(slot).assign( std::forward<Functor>(f) );
+            high_post_cursor->publish(slot);
+         }
+
+         /**
+          *  Limits how many high priority functors run before each batch,
+          *  so that a flood of them cannot starve the other cursors.  The
+          *  default of 0 is strict priority: the high lane is drained 
+          *  completely.  Must be called before start().
+          */
+         void set_high_priority_weight( uint32_t n );
+
+         /**
+          *  Calls f on this thread and returns a future for its result.
+          *  May be called from any thread.  Neither the call nor the
+          *  future allocate once their state pools have warmed up.
+          */
+         template<typename Functor>
+         future<typename std::result_of<typename std::decay<Functor>::type()>::type> async( Functor&& f )
+         {
+            typedef typename std::decay<Functor>::type     function;
+            typedef typename std::result_of<function()>::type result;
+
+            auto     state = detail::future_state<result>::create();
+            function func( std::forward<Functor>(f) );
+            atomic_post( [state,func]() mutable 
+            { 
+               state->run( func ); 
+               state->release(); 
+            } );
+            return future<result>( state );
+         }
+
+
+         /**
+          *  Calls h whenever c has events available.  Cursors may be added
+          *  from any thread.  From start() until join() returns the handler
+          *  is installed by the thread itself after its current sweep, so
+          *  one added after stop() waits for the next start().
+          *
+          *  The cursors c follows ring a bell when they publish and the
+          *  thread only checks the handlers whose bell rang, so idle
+          *  cursors cost nothing however many there are.  When no handler
+          *  has work the thread parks until a bell rings, so c should 
+          *  follow its sources before it is added.  Sources followed later
+          *  are only noticed when the thread is about to park.
+          *
+          *  If every cursor c follows is the cursor of another handler of
+          *  this thread, or a writer declared with add_local_writer(), the
+          *  edge never leaves the thread: h is handed the position its 
+          *  sources were last published at as a plain integer, and they 
+          *  mark it ready directly, rather than through the barrier and 
+          *  bells.  A pipeline collapsed onto one thread then pays no
+          *  fence between its stages.  The sources of such a handler are 
+          *  read when it, or they, are added and again after c starts or
+          *  stops following a cursor, until then c is checked through its
+          *  barrier.
+          */
+         template<typename Handler>
+         void add_cursor( read_cursor_ptr c, Handler&& h )
+         {
+            add_handler( std::move(c), detail::handler_ref( std::forward<Handler>(h) ), 1 );
+         }
+
+         /**
+          *  Like add_cursor( c, h ) but while c has a backlog each turn of
+          *  h may run for weight times as long as that of a handler of 
+          *  weight 1, about 50 us, before h is preempted at the end of its
+          *  current batch.
+          */
+         template<typename Handler>
+         void add_cursor( read_cursor_ptr c, Handler&& h, uint32_t weight )
+         {
+            add_handler( std::move(c), detail::handler_ref( std::forward<Handler>(h) ), weight );
+         }
+
+         /**
+          *  Like add_cursor( c, h, weight ) and calls drained() once h has 
+          *  processed every event it was given, so once per burst however 
+          *  many batches it took.  drained() is always called before those
+          *  events are released to c's writer, even if more have arrived
+          *  meanwhile, so a stage that queued writes pointing into the 
+          *  ring can flush them with one syscall.
+          *
+          *  @code
+             t.add_cursor( c, 
+                [&]( int64_t begin, int64_t end ) { queue( begin, end ); return end; },
+                [&]() { flush(); } );
+          *  @endcode
+          */
+         template<typename Handler, typename Drained>
+         typename std::enable_if<!std::is_integral<typename std::decay<Drained>::type>::value>::type
+         add_cursor( read_cursor_ptr c, Handler&& h, Drained&& drained, uint32_t weight = 1 )
+         {
+            typedef detail::void_handler<typename std::decay<Drained>::type> adapter;
+            add_handler( std::move(c), detail::handler_ref( std::forward<Handler>(h) ), weight,
+                         detail::handler_ref( adapter{ std::forward<Drained>(drained) } ) );
+         }
+
+         /** how much of the thread a handler has used since it was added */
+         struct handler_usage
+         {
+            read_cursor_ptr cursor;
+            uint32_t        weight;
+            int64_t         events;
+            /** how many turns ended because they were over budget */
+            uint32_t        preemptions;
+            /** the fraction of the time spent in handlers that was spent in this one */
+            double          share;
+         };
+
+         /** 
+          *  May be called from any thread, other threads wait for this one
+          *  to collect the usage between sweeps, so between stop() and 
+          *  join() only the thread itself may call it.
+          */
+         std::vector<handler_usage> usage();
+
+         /**
+          *  Stops calling the handler of c.  Like add_cursor() this may be
+          *  called from any thread while the thread is running.  This does
+          *  not stop c from gating its writer, use detach() for that.
+          */
+         void remove_cursor( read_cursor_ptr c );
+
+         /**
+          *  Declares that w is only ever published by handlers running on
+          *  this thread, so that handlers of cursors following it are 
+          *  treated as local, see add_cursor().  The thread reads w's 
+          *  position after each sweep instead of being notified by it. 
+          *  Like add_cursor() this may be called while the thread is 
+          *  running.
+          */
+         void add_local_writer( std::shared_ptr<const event_cursor> w );
+
+         /**
+          *  Calls h( fd, events ) on this thread whenever fd is ready for any
+          *  of events, which are given as for epoll_ctl().  Between sweeps 
+          *  of the cursors the thread checks its fds without blocking, and
+          *  when neither has work it blocks in epoll_wait(), so a single 
+          *  thread serves both sockets and rings.  Like add_cursor() this 
+          *  may be called while the thread is running.
+          *
+          *  @param h - void( int fd, uint32_t events )
+          */
+         template<typename Handler>
+         void add_fd( int fd, uint32_t events, Handler&& h )
+         {
+            typedef detail::fd_handler<typename std::decay<Handler>::type> adapter;
+            add_fd_handler( fd, events, detail::handler_ref( adapter{ std::forward<Handler>(h) } ) );
+         }
+
+         /** stops watching fd, the caller still owns and closes it */
+         void remove_fd( int fd );
+
+         typedef std::chrono::steady_clock                     clock;
+         typedef detail::timer_wheel<detail::functor>::handle  timer;
+
+         /** timers are kept to a resolution of 1 ms and never run early */
+         static const int64_t tick_ns = 1000*1000;
+
+         /**
+          *  Calls f on this thread once deadline has passed.  Like the
+          *  handlers, timers belong to the thread, so this must be called
+          *  before start() or from code running on this thread.  Other
+          *  threads can atomic_post() a call to it.
+          *
+          *  @return a handle for cancel()
+          */
+         template<typename Functor>
+         timer post_at( clock::time_point deadline, Functor&& f )
+         {
+            assert( owned_here() && "timers belong to the thread, atomic_post() the call to it" );
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>( deadline.time_since_epoch() ).count();
+            return _timers.add( (ns + tick_ns - 1) / tick_ns, std::forward<Functor>(f) );
+         }
+
+         /** calls f on this thread once d has passed, see post_at() */
+         template<typename Rep, typename Period, typename Functor>
+         timer post_after( std::chrono::duration<Rep,Period> d, Functor&& f )
+         {
+            return post_at( clock::now() + d, std::forward<Functor>(f) );
+         }
+
+         /**
+          *  Must be called from the same places as post_at().
+          *  @return true if t had not run yet and now never will
+          */
+         bool cancel( timer t ) 
+         { 
+            assert( owned_here() && "timers belong to the thread, atomic_post() the call to it" );
+            return _timers.cancel( t ); 
+         }
+
+         /**
+          *  Runs the thread on cpu only, cpu_topology::place() picks cpus
+          *  for a pipeline.  Before start() the thread pins itself as it
+          *  starts, afterwards it does so after its current sweep.
+          */
+         void set_affinity( int cpu );
 
          void start();
          void stop();
          void join();
 
       private:
+         friend class detail::thread_impl;
+
+         /** 
+          *  Constructs make( i ) .. make( i + count - 1 ) in the slots from
+          *  first on and advances i, publishes the slots if make() throws.
+          */
+         template<typename Generator>
+         void fill( int64_t first, uint32_t count, uint32_t& i, Generator& make, bool shared )
+         {
+            uint32_t j = 0;
+            try
+            {
+               for( ; j < count; ++j, ++i )
+                  post_buffer.at( first + j ).assign( make( i ) );
+            }
+            catch ( ... )
+            {
+               for( ; j < count; ++j ) post_buffer.at( first + j ).assign( [](){} );
+               if( shared ) post_cursor->publish_after( first + count - 1, first - 1 );
+               else         post_cursor->publish( first + count - 1 );
+               throw;
+            }
+         }
+
+         /** @return true if not started, or joined, or called by the thread itself */
+         bool owned_here()const;
+
+         void add_handler( read_cursor_ptr c, detail::handler_ref&& h, uint32_t weight,
+                           detail::handler_ref&& drained = detail::handler_ref() );
+         void add_fd_handler( int fd, uint32_t events, detail::handler_ref&& h );
+
+         /** @return the current time in ticks */
+         static int64_t now_tick()
+         {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>( 
+                        clock::now().time_since_epoch() ).count() / tick_ns;
+         }
+
+         detail::timer_wheel<detail::functor>   _timers;
+
          shared_write_cursor_ptr                post_cursor;
          ring_buffer<detail::functor,256>       post_buffer;
+         shared_write_cursor_ptr                high_post_cursor;
+         ring_buffer<detail::functor,256>       high_post_buffer;
          std::unique_ptr<detail::thread_impl>   my;
    };
 }
@@ -0,0 +1,252 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+
+namespace disruptor
+{
+namespace detail
+{
+
+/**
+ *  A hierarchical timing wheel of 4 levels of 64 slots, each level 64
+ *  times coarser than the one below it.  A timer is linked into the
+ *  slot of the coarsest level its deadline fits in and moves down a
+ *  level each time the level below wraps, so adding and cancelling
+ *  are O(1) and each tick only looks at one slot.  Deadlines beyond the
+ *  top level, 2^24 ticks away, wait in the top level and are placed
+ *  again as it turns.
+ *
+ *  Times are in ticks, the caller picks the resolution.  The wheel is
+ *  not thread safe, it belongs to the thread that calls advance().
+ *
+ *  Callback is constructed in place with assign(f), run with call() and
+ *  destroyed without running with destroy().
+ */
+template<typename Callback>
+class timer_wheel
+{
+   struct node;
+
+   public:
+      enum { bits = 6, slots = 1 << bits, levels = 4 };
+
+      /** identifies a timer, it stays safe to cancel after the timer ran */
+      struct handle
+      {
+         handle():_node(nullptr),_generation(0){}
+         handle( node* n, uint32_t g ):_node(n),_generation(g){}
+
+         node*     _node;
+         uint32_t  _generation;
+      };
+
+      timer_wheel( int64_t now = 0 ):_current(now),_size(0),_free(nullptr)
+      {
+         for( int l = 0; l < levels; ++l )
+         {
+            _occupied[l] = 0;
+            for( int s = 0; s < slots; ++s ) _slots[l][s] = nullptr;
+         }
+      }
+
+      ~timer_wheel()
+      {
+         for( int l = 0; l < levels; ++l )
+            for( int s = 0; s < slots; ++s )
+               for( node* n = _slots[l][s]; n; n = n->next )
+                  n->callback.destroy();
+      }
+
+      /** @return the number of pending timers */
+      uint32_t size()const { return _size; }
+
+      /** the tick advance() was last called with */
+      int64_t  now()const  { return _current; }
+
+      /** schedules f to run once advance() reaches expires */
+      template<typename Functor>
+      handle add( int64_t expires, Functor&& f )
+      {
+         node* n = _free;
+         if( n ) _free = n->next;
+         else  { _nodes.emplace_back(); n = &_nodes.back(); }
+
+         n->callback.assign( std::forward<Functor>(f) );
+         n->expires = expires;
+         place( n, _current + 1 );
+         ++_size;
+         return handle( n, n->generation );
+      }
+
+      /** @return true if the timer was pending and will no longer run */
+      bool cancel( handle h )
+      {
+         node* n = h._node;
+         if( !n || n->generation != h._generation || n->where < 0 ) return false;
+         unlink( n );
+         n->callback.destroy();
+         recycle( n );
+         return true;
+      }
+
+      /**
+       *  Runs every timer that expires at or before now.  Timers added by
+       *  the callbacks for a tick that already passed run on the next call.
+       *
+       *  @return the number of timers run
+       */
+      uint32_t advance( int64_t now )
+      {
+         if( !_size )
+         {
+            if( now > _current ) _current = now;
+            return 0;
+         }
+
+         uint32_t count = 0;
+         while( _current < now )
+         {
+            ++_current;
+            for( int l = 1; l < levels; ++l )
+            {
+               if( index( _current, l - 1 ) != 0 ) break;
+               cascade( l, index( _current, l ) );
+            }
+
+            node*& slot = _slots[0][index( _current, 0 )];
+            while( slot )
+            {
+               node* n = slot;
+               unlink( n );
+               // recycled even if the callback throws, after it can no longer run
+               struct guard
+               {
+                  timer_wheel* w; node* n;
+                  ~guard() { w->recycle( n ); }
+               } g = { this, n };
+               ++count;
+               n->callback.call();
+            }
+            if( !_size ) { _current = now; break; }
+         }
+         return count;
+      }
+
+      /**
+       *  @return a tick no later than the next deadline, so a thread may
+       *          sleep until then, or INT64_MAX if there are no timers.
+       */
+      int64_t next_expiry()const
+      {
+         if( !_size ) return 0x7fffffffffffffff;
+
+         int64_t next = 0x7fffffffffffffff;
+         if( _occupied[0] )
+         {
+            // the first occupied slot after the current one
+            uint32_t start = (index( _current, 0 ) + 1) & (slots - 1);
+            uint64_t r     = start ? (_occupied[0] >> start) | (_occupied[0] << (slots - start))
+                                   : _occupied[0];
+            next = _current + 1 + __builtin_ctzll( r );
+         }
+         for( int l = 1; l < levels; ++l )
+         {
+            if( _occupied[l] )
+            {
+               // nothing above level 0 can expire before level 0 next wraps
+               int64_t wrap = ((_current >> bits) + 1) << bits;
+               return std::min( next, wrap );
+            }
+         }
+         return next;
+      }
+
+   private:
+      struct node
+      {
+         node():prev(nullptr),next(nullptr),expires(0),generation(0),where(-1){}
+
+         node*      prev;
+         node*      next;
+         int64_t    expires;
+         uint32_t   generation;
+         /** level * slots + slot, or -1 when not linked */
+         int32_t    where;
+         Callback   callback;
+      };
+
+      static uint32_t index( int64_t tick, int level )
+      {
+         return uint32_t( tick >> (bits*level) ) & (slots - 1);
+      }
+
+      /** links n into the slot for its deadline, which is treated as no earlier than min */
+      void place( node* n, int64_t min )
+      {
+         const int64_t span    = int64_t(1) << (bits*levels);
+         int64_t       expires = std::max( n->expires, min );
+         int64_t       delta   = expires - _current;
+         if( delta >= span )
+         {
+            expires = _current + span - 1;
+            delta   = span - 1;
+         }
+
+         int level = 0;
+         while( level < levels - 1 && delta >= (int64_t(1) << (bits*(level+1))) ) ++level;
+
+         uint32_t s = index( expires, level );
+         node*& head = _slots[level][s];
+         n->prev  = nullptr;
+         n->next  = head;
+         n->where = level * slots + s;
+         if( head ) head->prev = n;
+         head = n;
+         _occupied[level] |= uint64_t(1) << s;
+      }
+
+      void unlink( node* n )
+      {
+         int    level = n->where / slots;
+         int    s     = n->where % slots;
+         node*& head  = _slots[level][s];
+         if( n->prev ) n->prev->next = n->next;
+         else          head          = n->next;
+         if( n->next ) n->next->prev = n->prev;
+         if( !head ) _occupied[level] &= ~(uint64_t(1) << s);
+         n->where = -1;
+      }
+
+      void recycle( node* n )
+      {
+         ++n->generation;
+         n->next = _free;
+         _free   = n;
+         --_size;
+      }
+
+      /** moves every timer in a slot down to the levels below */
+      void cascade( int level, uint32_t s )
+      {
+         node* n = _slots[level][s];
+         _slots[level][s] = nullptr;
+         _occupied[level] &= ~(uint64_t(1) << s);
+         while( n )
+         {
+            node* next = n->next;
+            place( n, _current );
+            n = next;
+         }
+      }
+
+      int64_t            _current;
+      uint32_t           _size;
+      node*              _free;
+      uint64_t           _occupied[levels];
+      node*              _slots[levels][slots];
+      std::deque<node>   _nodes;
+};
+
+} // namespace detail
+} // namespace disruptor
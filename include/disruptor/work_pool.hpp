@@ -0,0 +1,135 @@
+#pragma once
+#include "cursor_group.hpp"
+#include <algorithm>
+
+namespace disruptor
+{
+
+/**
+ *  A worker in a work_pool.  Unlike a plain read_cursor which sees every
+ *  event, a work cursor claims batches of slots from the sequence shared by
+ *  all workers of its pool so that each event is processed by exactly one
+ *  worker.
+ *
+ *  The position of a work cursor is always below the first slot it has
+ *  claimed but not yet completed, which is what allows the pool to expose
+ *  the min of its workers as a single position.
+ *
+ *  Pool provides the shared _work sequence, the _batch_size and is told
+ *  about every completed range through completed( first, last ).
+ *
+ *  @code
+     auto w = pool->worker(i);
+     while( true )
+     {
+        auto end = w->wait_next();
+        for( auto pos = w->begin(); pos < end; ++pos )
+           dest->at(pos) = expensive( source->at(pos) );
+        w->publish( end - 1 );
+     }
+ *  @endcode
+ */
+template<typename Pool>
+class basic_work_cursor : public read_cursor
+{
+   public:
+      basic_work_cursor( Pool& p, const char* n )
+      :read_cursor(n),_pool(p),_claim_end(0)
+      {
+         _cursor.store(-1);
+      }
+
+      /**
+       *  Claims the next batch from the pool if the current one has been
+       *  completed and then waits for at least the first slot of the batch
+       *  to become available.
+       *
+       *  @return end() which is > begin() and never past the claimed batch
+       */
+      int64_t wait_next()
+      {
+         if( _begin >= _claim_end )
+         {
+            auto batch = _pool._batch_size;
+            _begin     = _pool._work.atomic_increment_and_get( batch ) - batch + 1;
+            _claim_end = _begin + batch;
+
+            // every slot below _begin has been claimed and anything still pending
+            // there belongs to a worker whose position is lower than ours.
+            _cursor.store( _begin - 1 );
+            _pool.update();
+         }
+         try
+         {
+            read_cursor::wait_for( _begin );
+         }
+         catch ( const eof& ) { _pool.member_eof( *this ); throw; }
+         catch ( ... ) { _pool.member_alert( std::current_exception() ); throw; }
+
+         return _end = std::min( _end, _claim_end );
+      }
+
+      /** marks everything up to p complete and updates the pool position */
+      void publish( int64_t p )
+      {
+         auto first = _begin;
+         read_cursor::publish( p );
+         _pool.completed( first, p );
+      }
+
+   private:
+      Pool&        _pool;
+      int64_t      _claim_end;
+};
+
+class work_pool;
+typedef basic_work_cursor<work_pool>  work_cursor;
+typedef std::shared_ptr<work_cursor>  work_cursor_ptr;
+
+/**
+ *  Spreads the events of a stream over a number of workers, each of which
+ *  is expected to run in its own thread.  Workers atomically claim events
+ *  (or batches of batch_size events) from a shared work sequence.
+ *
+ *  The pool itself is a cursor_group whose position is the minimum position
+ *  completed by every worker, so producers and later stages may follow the
+ *  pool just like any other cursor.
+ *
+ *  @code
+      auto p    = std::make_shared<write_cursor>("write",SIZE);
+      auto pool = std::make_shared<work_pool>("pool", 4, 16 );
+      auto c    = std::make_shared<read_cursor>("c");
+
+      pool->follows(p);
+      c->follows(pool);
+      p->follows(c);
+ *  @endcode
+ */
+class work_pool : public cursor_group<work_cursor>
+{
+   public:
+      work_pool( const char* n, uint32_t num_workers, int64_t batch_size = 1 )
+      :cursor_group<work_cursor>(n),_batch_size(batch_size)
+      {
+         assert( num_workers > 0 && batch_size > 0 );
+         _work.store(-1);
+         for( uint32_t i = 0; i < num_workers; ++i )
+            _members.push_back( std::make_shared<work_cursor>( *this, n ) );
+      }
+
+      const work_cursor_ptr& worker( uint32_t i )const { return _members[i]; }
+      uint32_t               size()const               { return _members.size(); }
+
+   private:
+      friend class basic_work_cursor<work_pool>;
+
+      void completed( int64_t, int64_t ) { update(); }
+
+      const int64_t                 _batch_size;
+      /** the last slot claimed by any worker */
+      sequence                      _work;
+};
+
+typedef std::shared_ptr<work_pool> work_pool_ptr;
+
+} // namespace disruptor
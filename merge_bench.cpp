@@ -0,0 +1,130 @@
+#include <disruptor/merge.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  N feeds publish ticks in timestamp order, a merge_stage merges them
+ *  into one ring and a reader checks that the merged ticks are in order
+ *  and that none was lost.
+ */
+
+struct tick
+{
+   int64_t time;
+   int64_t value;
+};
+
+struct tick_time { int64_t operator()( const tick& t )const { return t.time; } };
+
+typedef ring_buffer<tick,SIZE>                       tick_ring;
+typedef merge_stage< tick_ring, tick_ring, tick_time > merger;
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** @return ticks per second, or 0 if the output was out of order or incomplete */
+double run( uint32_t feeds, int64_t per_feed )
+{
+   auto out        = std::make_shared<tick_ring>();
+   auto out_cursor = std::make_shared<write_cursor>("merged",SIZE);
+   auto c          = std::make_shared<read_cursor>("check");
+   c->follows(out_cursor);
+   out_cursor->follows(c);
+   c->start_at(-1);
+
+   merger m( out, out_cursor );
+   std::vector<std::shared_ptr<tick_ring>> buffers;
+   std::vector<write_cursor_ptr>           writers;
+   for( uint32_t i = 0; i < feeds; ++i )
+   {
+      auto w = std::make_shared<write_cursor>("feed",SIZE);
+      auto r = std::make_shared<read_cursor>("feed");
+      r->follows(w);
+      w->follows(r);
+      r->start_at(-1);
+      buffers.push_back( std::make_shared<tick_ring>() );
+      writers.push_back( w );
+      m.add_input( buffers.back(), r );
+   }
+
+   // feeds interleave, each one's times only increase but by uneven steps
+   auto feed_thread = [&]( uint32_t i ){
+      auto    p    = writers[i];
+      auto    pos  = p->begin();
+      auto    end  = p->end();
+      int64_t time = i;
+      for( int64_t n = 0; n < per_feed; ++n )
+      {
+         if( pos >= end )
+         {
+            end = p->wait_for(pos);
+         }
+         time += 1 + (n * 2654435761u + i) % (2 * feeds);
+         tick& t = buffers[i]->at(pos);
+         t.time  = time;
+         t.value = n;
+         p->publish(pos);
+         ++pos;
+      }
+      p->set_eof();
+   };
+
+   int64_t count = 0, sum = 0, last = -1;
+   bool    ordered = true;
+   auto check_thread = [&](){
+      try
+      {
+         auto pos = c->begin();
+         auto end = c->end();
+         while( true )
+         {
+            if( pos == end )
+            {
+               c->publish(pos-1);
+               end = c->wait_for(end);
+            }
+            const tick& t = out->at(pos);
+            ordered &= t.time >= last;
+            last     = t.time;
+            sum     += t.value;
+            ++count;
+            ++pos;
+         }
+      }
+      catch ( const eof& ){}
+   };
+
+   double start = now();
+   std::thread ct( check_thread );
+   std::thread mt( [&](){ m.run(); } );
+   std::vector<std::thread> threads;
+   for( uint32_t i = 0; i < feeds; ++i )
+      threads.push_back( std::thread( feed_thread, i ) );
+   for( auto itr = threads.begin(); itr != threads.end(); ++itr )
+      itr->join();
+   mt.join();
+   ct.join();
+   double elapsed = now() - start;
+
+   if( !ordered || count != feeds * per_feed || sum != feeds * (per_feed * (per_feed - 1) / 2) ) return 0;
+   return count / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t ticks = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 20;
+
+   std::cout.precision(15);
+   for( uint32_t feeds = 2; feeds <= 16; feeds *= 2 )
+      std::cout << feeds << " feeds merged: " << run( feeds, ticks / feeds ) << " ticks/sec" << std::endl;
+   return 0;
+}
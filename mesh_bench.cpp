@@ -0,0 +1,146 @@
+#include <disruptor/runtime.hpp>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+/**
+ *  Every core of a runtime sends messages to every other core, either
+ *  through the runtime's mailboxes or with atomic_post() to the
+ *  receiving thread.  Senders keep at most a window of messages in flight
+ *  to each peer and poll for credit in a functor that they keep sending
+ *  to themselves.  A receiver only releases its slots after the batch it
+ *  is running, so a ring may hold two windows from every sender, which
+ *  must fit or the cores end up waiting on each other.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** messages received by one core from another, written only by the receiver */
+struct counter
+{
+   counter():received(0){}
+   std::atomic<int64_t> received;
+   char                 pad[56];
+};
+
+struct bench
+{
+   bench( runtime& r, int64_t n, bool m )
+   :rt(r),cores(r.size()),per_peer(n),mesh(m),
+    window( std::min<int64_t>( 64, 120 / cores ) ),
+    counters( cores * cores ),sent( cores * cores, 0 ),done(0){}
+
+   runtime&               rt;
+   uint32_t               cores;
+   int64_t                per_peer;
+   bool                   mesh;
+   int64_t                window;
+   std::vector<counter>   counters;  // [from * cores + to]
+   std::vector<int64_t>   sent;      // [from * cores + to], written only by from
+   std::atomic<uint32_t>  done;
+
+   template<typename Functor>
+   void send( uint32_t to, Functor&& f )
+   {
+      if( mesh ) rt.send( to, std::forward<Functor>(f) );
+      else       rt.core(to).atomic_post( std::forward<Functor>(f) );
+   }
+
+   /** runs on core from until it has sent per_peer messages to every peer */
+   void pump( uint32_t from )
+   {
+      bool finished = true;
+      for( uint32_t to = 0; to < cores; ++to )
+      {
+         if( to == from ) continue;
+         int64_t& s = sent[from * cores + to];
+         counter* c = &counters[from * cores + to];
+         int64_t  limit = std::min( per_peer, c->received.load( std::memory_order_acquire ) + window );
+         for( ; s < limit; ++s )
+            send( to, [c]() { c->received.store( c->received.load( std::memory_order_relaxed ) + 1,
+                                                 std::memory_order_release ); } );
+         finished &= s == per_peer;
+      }
+      if( finished ) ++done;
+      else           send( from, [this,from]() { pump( from ); } );
+   }
+
+   double run()
+   {
+      double start = now();
+      for( uint32_t i = 0; i < cores; ++i )
+         rt.core(i).atomic_post( [this,i]() { pump( i ); } );
+
+      for( uint32_t i = 0; i < cores * cores; ++i )
+         while( i / cores != i % cores && counters[i].received.load() < per_peer ) usleep( 100 );
+      double elapsed = now() - start;
+
+      // the last pumps may still be on their way
+      while( done.load() < cores ) usleep( 100 );
+      return cores * (cores - 1) * per_peer / elapsed;
+   }
+};
+
+/**
+ *  Stalls core 1 of a new runtime from before it starts while core 0
+ *  sends it several mailboxes worth of messages, so the sender wraps the
+ *  ring and waits on a receiver that has not served its mailbox yet,
+ *  then lets core 1 run.
+ *
+ *  @return true if every message ran exactly once and in the order sent
+ */
+bool flood()
+{
+   const int64_t        count = runtime::mailbox_size * 4;
+   std::atomic<bool>    release(false);
+   std::atomic<int64_t> ran(0);
+   std::vector<int64_t> order; // only touched by core 1
+
+   runtime rt(2);
+   rt.core(1).atomic_post( [&]() { while( !release ) usleep( 100 ); } );
+   rt.start();
+   // after start so that it runs as core 0 and sends through the mailbox
+   rt.core(0).atomic_post( [&]()
+   {
+      for( int64_t i = 0; i < count; ++i )
+         rt.send( 1, [&,i]() { order.push_back( i ); ++ran; } );
+   });
+   usleep( 100*1000 );
+   release = true;
+
+   for( int i = 0; ran.load() < count && i < 50*1000; ++i ) usleep( 100 );
+   rt.stop();
+   rt.join();
+   if( ran.load() != count ) return false;
+   for( int64_t i = 0; i < count; ++i )
+      if( order[i] != i ) return false;
+   return true;
+}
+
+int main( int argc, char** argv )
+{
+   uint32_t cores    = argc > 1 ? atoi( argv[1] ) : 4;
+   int64_t  per_peer = argc > 2 ? atoll( argv[2] ) : 100 * 1000;
+
+   std::cout << "flooding a stalled core's mailbox: " << (flood() ? "in order" : "lost or reordered messages") << "\n";
+
+   runtime rt( cores );
+   rt.start();
+
+   std::cout.precision(15);
+   for( int i = 0; i < 2; ++i )
+   {
+      std::cout << cores << " cores all-to-all with atomic_post:  " << bench( rt, per_peer, false ).run() << " messages/sec\n";
+      std::cout << cores << " cores all-to-all through mailboxes: " << bench( rt, per_peer, true ).run() << " messages/sec\n";
+   }
+
+   rt.stop();
+   rt.join();
+   return 0;
+}
@@ -0,0 +1,145 @@
+#include <disruptor/optional_cursor.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  One producer and a fast reader that gates it, run alone and then with
+ *  a slow optional reader that either never gates the producer or gates
+ *  it while within a lag limit.  The slow reader is lapped over and over
+ *  and skips ahead, it checks that every event it accepted as valid was
+ *  the one it expected at that position.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** what the slow reader does with each event */
+uint64_t analyse( uint64_t x )
+{
+   for( int i = 0; i < 256; ++i ) x = x * 6364136223846793005ull + 1442695040888963407ull;
+   return x;
+}
+
+enum mode { none = -2 };
+
+/** prints the producer's events per second, or 0 if a reader saw a wrong event */
+void run( const char* label, int64_t lag_limit, uint64_t iterations )
+{
+   auto source = std::make_shared<ring_buffer<int64_t,SIZE>>();
+   auto p      = std::make_shared<write_cursor>("write",SIZE);
+   auto c      = std::make_shared<read_cursor>("fast");
+   c->follows(p);
+   p->follows(c);
+   c->start_at(-1);
+
+   auto pub_thread = [=](){
+      auto pos = p->begin();
+      auto end = p->end();
+      for( uint64_t i = 0; i < iterations; ++i )
+      {
+         if( pos >= end )
+         {
+            end = p->wait_for(pos);
+         }
+         source->at(pos) = pos;
+         p->publish(pos);
+         ++pos;
+      }
+      p->set_eof();
+   };
+
+   bool fast_ok = true;
+   auto fast_thread = [&](){
+      try
+      {
+         auto pos = c->begin();
+         auto end = c->end();
+         while( true )
+         {
+            if( pos == end )
+            {
+               c->publish(pos-1);
+               end = c->wait_for(end);
+            }
+            fast_ok &= source->at(pos) == pos;
+            ++pos;
+         }
+      }
+      catch ( const eof& ){}
+   };
+
+   uint64_t accepted = 0, wrong = 0, result = 0;
+   std::shared_ptr<optional_cursor> o;
+   if( lag_limit != none )
+   {
+      o = std::make_shared<optional_cursor>( "slow", p, lag_limit );
+      o->attach();
+   }
+   auto slow_thread = [&](){
+      try
+      {
+         auto pos = o->begin();
+         auto end = o->end();
+         while( true )
+         {
+            if( pos == end )
+            {
+               o->publish(pos-1);
+               end = o->wait_for(end);
+               pos = o->begin();
+            }
+            int64_t e = source->at(pos);
+            if( o->valid(pos) )
+            {
+               result ^= analyse( e );
+               wrong  += e != pos;
+               ++accepted;
+            }
+            ++pos;
+         }
+      }
+      catch ( const eof& ){}
+   };
+
+   double start = now();
+   std::thread ft( fast_thread );
+   std::thread st;
+   if( o ) st = std::thread( slow_thread );
+   std::thread pt( pub_thread );
+   pt.join();
+   double elapsed = now() - start;
+   ft.join();
+   if( o ) st.join();
+
+   std::cout << label << (fast_ok && !wrong ? iterations / elapsed : 0) << " ops/secs";
+   if( o )
+   {
+      o->detach();
+      std::cout << ", the slow reader took " << accepted << " events and skipped " 
+                << o->skipped() << " in " << o->skips() << " skips";
+   }
+   std::cout << std::endl;
+}
+
+int main( int argc, char** argv )
+{
+   uint64_t iterations = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 50;
+
+   std::cout.precision(15);
+   for( int i = 0; i < 2; ++i )
+   {
+      run( "1P-1C:                         ", none, iterations );
+      run( "1P-1C + non gating reader:     ", optional_cursor::non_gating, iterations );
+      run( "1P-1C + reader lag limit 512:  ", SIZE/2, iterations );
+   }
+   return 0;
+}
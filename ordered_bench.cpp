@@ -0,0 +1,127 @@
+#include <disruptor/ordered_stage.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  One producer feeding an ordered_stage whose workers take uneven time
+ *  per event, so batches complete out of order, followed by a reader
+ *  that checks every result is there, in sequence order, once the
+ *  stage says it is.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** costs more for some values than for others */
+uint64_t transform( uint64_t x )
+{
+   uint64_t r = x;
+   for( uint64_t i = 0; i < 8 + (x * 2654435761u) % 64; ++i ) r = r * 6364136223846793005ull + 1442695040888963407ull;
+   return r;
+}
+
+/** @return events per second, or 0 if a result was missing or out of order */
+double run( uint32_t num_workers, int64_t batch, uint64_t iterations )
+{
+   auto input  = std::make_shared<ring_buffer<uint64_t,SIZE>>();
+   auto output = std::make_shared<ring_buffer<uint64_t,SIZE>>();
+   auto p      = std::make_shared<write_cursor>("write",SIZE);
+   auto stage  = std::make_shared<ordered_stage>("transform",num_workers,SIZE,batch);
+   auto c      = std::make_shared<read_cursor>("check");
+
+   stage->follows(p);
+   c->follows(stage);
+   p->follows(c);
+   c->start_at(-1);
+
+   auto pub_thread = [=](){
+      auto pos = p->begin();
+      auto end = p->end();
+      for( uint64_t i = 0; i < iterations; ++i )
+      {
+         if( pos >= end )
+         {
+            end = p->wait_for(pos);
+         }
+         input->at(pos) = i;
+         p->publish(pos);
+         ++pos;
+      }
+      p->set_eof();
+   };
+
+   auto work_thread = [&]( uint32_t i ){
+      auto w = stage->worker(i);
+      try
+      {
+         while( true )
+         {
+            auto end = w->wait_next();
+            for( auto pos = w->begin(); pos < end; ++pos )
+               output->at(pos) = transform( input->at(pos) );
+            w->publish( end - 1 );
+         }
+      }
+      catch ( const eof& ){}
+   };
+
+   uint64_t checked = 0;
+   bool     ordered = true;
+   auto check_thread = [&](){
+      try
+      {
+         auto pos = c->begin();
+         auto end = c->end();
+         while( true )
+         {
+            if( pos == end )
+            {
+               c->publish(pos-1);
+               end = c->wait_for(end);
+            }
+            ordered &= output->at(pos) == transform( checked );
+            ++checked;
+            ++pos;
+         }
+      }
+      catch ( const eof& ){}
+   };
+
+   double start = now();
+   std::vector<std::thread> workers;
+   for( uint32_t i = 0; i < num_workers; ++i )
+      workers.push_back( std::thread( work_thread, i ) );
+   std::thread ct( check_thread );
+   std::thread pt( pub_thread );
+
+   pt.join();
+   for( auto itr = workers.begin(); itr != workers.end(); ++itr )
+      itr->join();
+   ct.join();
+   double elapsed = now() - start;
+
+   if( !ordered || checked != iterations ) return 0;
+   return iterations / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   uint64_t iterations = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 10;
+
+   std::cout.precision(15);
+   for( uint32_t workers = 1; workers <= 8; workers *= 2 )
+   {
+      std::cout << "1P-" << workers << "W-1C batch 1:  " << run( workers, 1, iterations )  << " ops/secs" << std::endl;
+      std::cout << "1P-" << workers << "W-1C batch 16: " << run( workers, 16, iterations ) << " ops/secs" << std::endl;
+   }
+   return 0;
+}
@@ -0,0 +1,133 @@
+#include <disruptor/partition.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+struct event
+{
+  uint64_t key;
+  uint64_t value;
+};
+
+#define SIZE 1024
+#define KEYS 4096
+
+/**
+ *  Runs one producer feeding num_shards partitioned consumers, each keeping
+ *  a running total per key.  Every event must be handled once, by the shard
+ *  its key maps to.
+ *
+ *  @return events per second, or 0 if an event was lost, handled twice or
+ *          handled by the wrong shard
+ */
+double run( uint16_t num_shards, uint64_t iterations )
+{
+   auto source = std::make_shared<ring_buffer<event,SIZE>>();
+   auto p      = std::make_shared<write_cursor>("write",SIZE);
+   auto group  = std::make_shared<partition_group>("shards",num_shards,SIZE);
+
+   group->follows(p);
+   p->follows(group);
+
+   auto pub_thread = [=](){
+      try
+      {
+        auto pos = p->begin();
+        auto end = p->end();
+        for( uint64_t i = 0; i < iterations; ++i )
+        {
+           if( pos >= end )
+           {
+              end = p->wait_for(pos);
+           }
+           event& e = source->at(pos);
+           e.key   = (i * 2654435761u) % KEYS;
+           e.value = i;
+           group->set_key( pos, e.key );
+           p->publish(pos);
+           ++pos;
+        }
+        p->set_eof();
+      }
+      catch ( std::exception& e )
+      {
+        std::cerr<<"publisher caught: "<<e.what()<<"\n";
+      }
+   };
+
+   // written by one shard each
+   std::vector<uint64_t> sums( num_shards * 8 );
+   std::vector<uint64_t> misplaced( num_shards * 8 );
+   auto shard_thread = [=,&sums,&misplaced]( uint16_t i ){
+      std::vector<uint64_t> totals(KEYS);
+      auto s = group->shard(i);
+      try
+      {
+         auto pos = s->begin();
+         auto end = s->end();
+         while( true )
+         {
+            if( pos == end )
+            {
+                s->publish(pos-1);
+                end = s->wait_for(end);
+            }
+            pos = s->next( pos, end );
+            if( pos == end ) continue;
+
+            const event& e = source->at(pos);
+            totals[e.key] += e.value;
+            misplaced[i*8] += e.key % num_shards != i;
+            ++pos;
+         }
+      }
+      catch ( const eof& ){}
+      catch ( std::exception& e )
+      {
+        std::cerr<<"shard "<<i<<" caught: "<<e.what()<<"\n";
+      }
+      for( uint64_t k = 0; k < KEYS; ++k ) sums[i*8] += totals[k];
+   };
+
+   struct timeval start_time, end_time;
+   gettimeofday(&start_time, NULL);
+
+   std::vector<std::thread> shards;
+   for( uint16_t i = 0; i < num_shards; ++i )
+      shards.push_back( std::thread( shard_thread, i ) );
+   std::thread pt( pub_thread );
+
+   pt.join();
+   for( auto itr = shards.begin(); itr != shards.end(); ++itr )
+      itr->join();
+
+   gettimeofday(&end_time, NULL);
+
+   double start, end;
+   start = start_time.tv_sec + ((double) start_time.tv_usec / 1000000);
+   end   = end_time.tv_sec + ((double) end_time.tv_usec / 1000000);
+
+   uint64_t total = 0;
+   for( uint16_t i = 0; i < num_shards; ++i )
+   {
+      if( misplaced[i*8] ) return 0;
+      total += sums[i*8];
+   }
+   if( total != iterations * (iterations - 1) / 2 ) return 0;
+   return (iterations * 1.0) / (end - start);
+}
+
+int main( int argc, char** argv )
+{
+   uint64_t iterations = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 50;
+
+   std::cout.precision(15);
+   for( uint16_t shards = 1; shards <= 16; shards *= 2 )
+   {
+      std::cout << "1P-" << shards << "SHARD performance: ";
+      std::cout << run( shards, iterations ) << " ops/secs" << std::endl;
+   }
+   return 0;
+}
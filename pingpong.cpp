@@ -1,12 +1,28 @@
 #include <disruptor/thread.hpp>
+#include <iostream>
+#include <sys/time.h>
 
 
-auto thread_a = new disruptor::thread(); 
-auto thread_b = new disruptor::thread(); 
+auto thread_a = new disruptor::thread();
+auto thread_b = new disruptor::thread();
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+double start_time = 0;
 
 void count( int64_t c, disruptor::thread* source, disruptor::thread* reply )
 {
-    if( c > (1LL << 24) ) exit(1);
+    if( c > (1LL << 24) )
+    {
+       std::cout.precision(15);
+       std::cout << "pingpong performance: " << c / (now() - start_time) << " posts/sec\n";
+       exit(1);
+    }
     reply->post( [=](){  count( c+1, reply, source ); } );
 }
 
@@ -16,6 +32,7 @@ int main( int argc, char** argv )
     thread_a->start();
     thread_b->start();
     usleep( 1000*1000*30 );
+    start_time = now();
     thread_a->post( [=]() { count( 1, thread_a, thread_b ); } );
     thread_a->join();
     thread_b->join();
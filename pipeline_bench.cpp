@@ -0,0 +1,148 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <thread>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  A producer and four stages all on one disruptor::thread.  The producer
+ *  is a functor that reposts itself and is declared with add_local_writer(),
+ *  so every edge stays on the thread.  The last stage checks each result
+ *  and that the events arrive in order.
+ *
+ *  The audited run also has another thread read behind stage 2.  Stage 3
+ *  starts following that reader from the thread after it is linked, and
+ *  checks that the reader has seen every event before stage 3 gets it.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+struct event
+{
+   int64_t value;
+   int64_t stage[3];
+   int64_t audited;
+};
+
+/** @return events per second, or 0 if a result was wrong, out of order or not audited */
+double run( int64_t iterations, bool audit )
+{
+   auto ring = std::make_shared<ring_buffer<event,SIZE>>();
+   auto p    = std::make_shared<write_cursor>("produce",SIZE);
+   std::vector<read_cursor_ptr> stages;
+   for( int i = 0; i < 4; ++i )
+   {
+      stages.push_back( std::make_shared<read_cursor>("stage") );
+      stages.back()->follows( i ? stages[i-1] : std::shared_ptr<event_cursor>(p) );
+      stages.back()->start_at(-1);
+   }
+   p->follows( stages.back() );
+
+   auto a = std::make_shared<read_cursor>("audit");
+   if( audit )
+   {
+      a->follows( stages[1] );
+      a->start_at(-1);
+      p->follows( a );
+   }
+
+   disruptor::thread t;
+   t.add_local_writer( p );
+
+   bool ok = true;
+   t.add_cursor( stages[0], [&]( int64_t begin, int64_t end ) -> int64_t {
+      for( auto pos = begin; pos < end; ++pos ) ring->at(pos).stage[0] = ring->at(pos).value + 1;
+      return end;
+   });
+   t.add_cursor( stages[1], [&]( int64_t begin, int64_t end ) -> int64_t {
+      for( auto pos = begin; pos < end; ++pos ) ring->at(pos).stage[1] = ring->at(pos).stage[0] * 3;
+      return end;
+   });
+   t.add_cursor( stages[2], [&]( int64_t begin, int64_t end ) -> int64_t {
+      for( auto pos = begin; pos < end; ++pos )
+      {
+         event& e = ring->at(pos);
+         ok &= !audit || e.audited == pos;
+         e.stage[2] = e.stage[1] - pos;
+      }
+      return end;
+   });
+   int64_t           next = 0;
+   std::atomic<bool> done(false);
+   t.add_cursor( stages[3], [&]( int64_t begin, int64_t end ) -> int64_t {
+      ok &= begin == next;
+      for( auto pos = begin; pos < end; ++pos )
+         ok &= ring->at(pos).stage[2] == 2 * pos + 3;
+      next = end;
+      if( next == iterations ) done = true;
+      return end;
+   });
+
+   // never blocks, the stages it waits on run between its turns
+   int64_t               pos   = 0;
+   bool                  first = true;
+   std::function<void()> produce = [&]() {
+      if( first && audit ) stages[2]->follows( a );
+      first = false;
+      int64_t end = std::min( p->check_end(), iterations );
+      if( pos < end )
+      {
+         for( ; pos < end; ++pos ) ring->at(pos).value = pos;
+         p->publish( pos - 1 );
+      }
+      if( pos < iterations ) t.post( [&](){ produce(); } );
+   };
+
+   // lags behind stage 2 so that stage 3 would pass it if it could
+   auto audit_thread = [&](){
+      auto apos = a->begin();
+      auto aend = a->end();
+      while( apos < iterations )
+      {
+         if( apos == aend )
+         {
+            a->publish(apos-1);
+            aend = a->wait_for(apos);
+            usleep(100);
+         }
+         ring->at(apos).audited = apos;
+         ++apos;
+      }
+      a->publish(apos-1);
+   };
+
+   double start = now();
+   t.post( [&](){ produce(); } );
+   t.start();
+   std::thread at;
+   if( audit ) at = std::thread( audit_thread );
+   while( !done.load() ) usleep(100);
+   double elapsed = now() - start;
+   if( audit ) at.join();
+   t.stop();
+   t.join();
+
+   if( !ok ) return 0;
+   return iterations / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t iterations = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 50;
+
+   std::cout.precision(15);
+   for( int i = 0; i < 2; ++i )
+   {
+      std::cout << "4 stages on one thread:                 " << run( iterations, false ) << " ops/secs" << std::endl;
+      std::cout << "4 stages on one thread, stage 3 audited: " << run( iterations / 10, true ) << " ops/secs" << std::endl;
+   }
+   return 0;
+}
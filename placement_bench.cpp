@@ -0,0 +1,104 @@
+#include <disruptor/affinity.hpp>
+#include <iostream>
+#include <stdlib.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+using namespace disruptor;
+
+/**
+ *  Checks cpu_topology::place() against a fake sysfs tree for a machine
+ *  with 2 sockets of 2 cores with 2 hyperthreads each.  Cpus 0-3 are the
+ *  first hyperthreads of the 4 cores and 4-7 their siblings, sockets are
+ *  {0,1,4,5} and {2,3,6,7}, each with its own L3 and an L2 per core.
+ *  Then prints where place() puts stages on this machine.
+ */
+
+void write_file( const std::string& path, const std::string& value )
+{
+   std::ofstream( path.c_str() ) << value << "\n";
+}
+
+/** one cache index of a cpu, as sysfs lists them */
+void write_cache( const std::string& dir, int index, int level, const char* type, const std::string& shared )
+{
+   std::string d = dir + "/cache/index" + std::to_string(index);
+   mkdir( d.c_str(), 0755 );
+   write_file( d + "/level", std::to_string(level) );
+   write_file( d + "/type", type );
+   write_file( d + "/shared_cpu_list", shared );
+}
+
+/** @return the root of a fake sysfs cpu tree */
+std::string write_fake_sysfs()
+{
+   char root[] = "/tmp/placement_benchXXXXXX";
+   if( !mkdtemp( root ) ) return std::string();
+   for( int c = 0; c < 8; ++c )
+   {
+      int core = c % 4, socket = core / 2;
+      std::string dir = std::string(root) + "/cpu" + std::to_string(c);
+      mkdir( dir.c_str(), 0755 );
+      mkdir( (dir + "/topology").c_str(), 0755 );
+      mkdir( (dir + "/cache").c_str(), 0755 );
+      write_file( dir + "/topology/thread_siblings_list", std::to_string(core) + "," + std::to_string(core + 4) );
+      write_file( dir + "/topology/physical_package_id", std::to_string(socket) );
+      std::string siblings = std::to_string(core) + "," + std::to_string(core + 4);
+      write_cache( dir, 0, 1, "Data",        siblings );
+      write_cache( dir, 1, 1, "Instruction", siblings );
+      write_cache( dir, 2, 2, "Unified",     siblings );
+      write_cache( dir, 3, 3, "Unified",     socket ? "2-3,6-7" : "0-1,4-5" );
+   }
+   return root;
+}
+
+void remove_tree( const std::string& root )
+{
+   nftw( root.c_str(), []( const char* path, const struct stat*, int, struct FTW* ) { return ::remove( path ); },
+         16, FTW_DEPTH | FTW_PHYS );
+}
+
+std::string to_string( const std::vector<int>& cpus )
+{
+   std::string s;
+   for( size_t i = 0; i < cpus.size(); ++i ) s += (i ? " " : "") + std::to_string( cpus[i] );
+   return s;
+}
+
+/** @return the number of wrong placements */
+int check_fake_machine()
+{
+   std::string root = write_fake_sysfs();
+   if( root.empty() ) { std::cout << "could not create a fake sysfs tree" << std::endl; return 1; }
+
+   cpu_set_t all;
+   CPU_ZERO( &all );
+   for( int c = 0; c < 8; ++c ) CPU_SET( c, &all );
+   cpu_topology topo( root, all );
+   remove_tree( root );
+
+   auto spread = topo.place( 4 );
+   auto shared = topo.place( 4, true );
+   auto wrap   = topo.place( 10 );
+   std::cout << "2 sockets x 2 cores x 2 hyperthreads, 4 stages: " << to_string( spread )
+             << ", sharing cores: " << to_string( shared ) << std::endl;
+
+   int wrong = topo.cpus().size() != 8;
+   wrong += to_string( spread ) != "0 1 2 3";
+   wrong += to_string( shared ) != "0 4 1 5";
+   wrong += to_string( wrap )   != "0 1 2 3 4 5 6 7 0 1";
+   wrong += !topo.same_core( 1, 5 ) || topo.same_core( 1, 2 );
+   wrong += !topo.shares_l2( 0, 4 ) || topo.shares_l2( 0, 1 );
+   wrong += !topo.shares_l3( 0, 5 ) || topo.shares_l3( 1, 2 );
+   return wrong;
+}
+
+int main()
+{
+   int wrong = check_fake_machine();
+   std::cout << wrong << " wrong" << std::endl;
+
+   cpu_topology here;
+   std::cout << "this machine, " << here.cpus().size() << " cpus, 4 stages: " << to_string( here.place( 4 ) ) << std::endl;
+   return wrong != 0;
+}
@@ -0,0 +1,74 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <thread>
+#include <sys/time.h>
+
+/**
+ *  Producers post small tasks to one disruptor::thread, either one at a
+ *  time with atomic_post() or in groups with atomic_post_bulk(), and the
+ *  thread counts them.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** @return tasks per second, or 0 if the thread did not run every task once */
+double run( disruptor::thread& t, uint32_t producers, int64_t tasks, uint32_t bulk )
+{
+   // only touched by t
+   static int64_t count = 0;
+   std::atomic<int64_t> finished(-1);
+   int64_t per_producer = tasks / producers;
+
+   t.atomic_post( [](){ count = 0; } );
+   double start = now();
+   std::vector<std::thread> threads;
+   for( uint32_t p = 0; p < producers; ++p )
+   {
+      threads.push_back( std::thread( [&]()
+      {
+         if( bulk == 1 )
+         {
+            for( int64_t i = 0; i < per_producer; ++i )
+               t.atomic_post( [](){ ++count; } );
+         }
+         else
+         {
+            for( int64_t i = 0; i < per_producer; i += bulk )
+               t.atomic_post_bulk( uint32_t( std::min<int64_t>( bulk, per_producer - i ) ), 
+                                   []( uint32_t ) { return [](){ ++count; }; } );
+         }
+      }));
+   }
+   for( auto itr = threads.begin(); itr != threads.end(); ++itr ) itr->join();
+   t.atomic_post( [&](){ finished = count; } );
+   while( finished.load() < 0 ) usleep( 100 );
+   double elapsed = now() - start;
+
+   if( finished.load() != per_producer * producers ) return 0;
+   return per_producer * producers / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t tasks = argc > 1 ? atoll( argv[1] ) : 2 * 1000 * 1000;
+
+   disruptor::thread t;
+   t.start();
+
+   std::cout.precision(15);
+   uint32_t producers[] = { 1, 4, 8 };
+   for( int i = 0; i < 3; ++i )
+   {
+      std::cout << producers[i] << " producers, atomic_post:          " << run( t, producers[i], tasks, 1 )  << " tasks/sec\n";
+      std::cout << producers[i] << " producers, atomic_post_bulk(32): " << run( t, producers[i], tasks, 32 ) << " tasks/sec\n";
+   }
+
+   t.stop();
+   t.join();
+   return 0;
+}
@@ -0,0 +1,108 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <chrono>
+
+using namespace disruptor;
+
+/**
+ *  Checks the high priority post lane of disruptor::thread: high posts
+ *  run in the order they were posted, a high post overtakes a backlog
+ *  of bulk work on the normal lane while a normal post waits for all of
+ *  it, and set_high_priority_weight() lets the normal lane run during a
+ *  flood of high posts that strict priority holds it back from.
+ */
+
+typedef std::chrono::steady_clock clock_type;
+
+/** keeps the thread busy for us microseconds */
+void spin( int64_t us )
+{
+   auto start = clock_type::now();
+   while( clock_type::now() - start < std::chrono::microseconds( us ) ) {}
+}
+
+/** @return the number of high posts that ran out of order */
+int64_t high_order( int64_t posts )
+{
+   disruptor::thread t;
+   t.start();
+   // only touched by t
+   int64_t next = 0, wrong = 0;
+   std::atomic<bool> finished(false);
+   for( int64_t i = 0; i < posts; ++i )
+   {
+      t.atomic_post( thread::high, [&,i](){ wrong += i != next++; } );
+      if( i % 7 == 0 ) t.atomic_post( [](){ spin(1); } );
+   }
+   t.atomic_post( thread::high, [&](){ finished = true; } );
+   while( !finished.load() ) usleep( 100 );
+   t.stop();
+   t.join();
+   std::cout << posts << " high posts, " << wrong << " out of order" << std::endl;
+   return wrong;
+}
+
+/**
+ *  Queues bulk functors of bulk_us each, then posts a control functor on
+ *  lane p once the thread is busy with them.
+ *
+ *  @return how many bulk functors ran before the control functor
+ */
+int64_t control_after( thread::priority p, int64_t bulk, int64_t bulk_us )
+{
+   disruptor::thread t;
+   std::atomic<int64_t> ran(0), at(-1);
+   for( int64_t i = 0; i < bulk; ++i )
+      t.atomic_post( [&](){ spin( bulk_us ); ++ran; } );
+   t.start();
+   while( ran.load() == 0 ) usleep( 100 );
+   t.atomic_post( p, [&](){ at = ran.load(); } );
+   while( ran.load() < bulk || at.load() < 0 ) usleep( 1000 );
+   t.stop();
+   t.join();
+   return at.load();
+}
+
+/** @return how many normal posts ran before the last of a flood of high ones */
+int64_t normal_during_flood( uint32_t weight, int64_t posts )
+{
+   disruptor::thread t;
+   t.set_high_priority_weight( weight );
+   // only touched by t
+   int64_t normal = 0, normal_before_last = -1;
+   std::atomic<bool> finished(false);
+   for( int64_t i = 0; i < posts; ++i )
+      t.atomic_post( [&](){ ++normal; } );
+   for( int64_t i = 0; i < posts; ++i )
+      t.atomic_post( thread::high, [&,i](){ if( i == posts - 1 ) normal_before_last = normal; } );
+   t.atomic_post( [&](){ finished = true; } );
+   t.start();
+   while( !finished.load() ) usleep( 100 );
+   t.stop();
+   t.join();
+   return normal_before_last;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t posts = argc > 1 ? atoll( argv[1] ) : 100 * 1000;
+   int     bad   = 0;
+
+   bad += high_order( posts ) != 0;
+
+   // both rings hold 256 functors, which bounds what is queued before start()
+   int64_t bulk = 250, bulk_us = 200;
+   int64_t high   = control_after( thread::high,   bulk, bulk_us );
+   int64_t normal = control_after( thread::normal, bulk, bulk_us );
+   std::cout << "with " << bulk << " queued " << bulk_us << " us bulk functors a high post ran after "
+             << high << " of them, a normal post after " << normal << std::endl;
+   bad += high >= bulk || normal != bulk;
+
+   int64_t strict   = normal_during_flood( 0, 200 );
+   int64_t weighted = normal_during_flood( 4, 200 );
+   std::cout << "normal posts run during 200 high posts: " << strict << " with strict priority, "
+             << weighted << " with a weight of 4" << std::endl;
+   bad += strict != 0 || weighted <= 0;
+
+   return bad;
+}
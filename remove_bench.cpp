@@ -0,0 +1,128 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+
+using namespace disruptor;
+
+/**
+ *  Removes handlers from a disruptor::thread before it starts and while
+ *  it runs, and checks that a removed handler is never called again,
+ *  that the others still see every event and that a handler added in
+ *  its place, which takes over its bell, is woken when its ring is
+ *  published to while the thread is parked.
+ */
+
+struct ring
+{
+   ring():w( std::make_shared<write_cursor>("write",1024) ),
+          r( std::make_shared<read_cursor>("read") ),
+          seen(0)
+   {
+      r->follows(w);
+      w->follows(r);
+      r->start_at(-1);
+   }
+
+   void publish( int64_t events )
+   {
+      for( int64_t i = 0; i < events; ++i )
+         w->publish( w->wait_next() );
+   }
+
+   void add_to( disruptor::thread& t )
+   {
+      t.add_cursor( r, [this]( int64_t begin, int64_t end ) { seen += end - begin; return end; } );
+   }
+
+   write_cursor_ptr     w;
+   read_cursor_ptr      r;
+   std::atomic<int64_t> seen;
+};
+
+/** @return true once every ring has seen its expected count, false after a second */
+bool wait_seen( const std::vector<ring*>& rings, const std::vector<int64_t>& expected )
+{
+   for( int i = 0; i < 1000; ++i )
+   {
+      bool all = true;
+      for( size_t r = 0; r < rings.size(); ++r ) all = all && rings[r]->seen.load() >= expected[r];
+      if( all ) return true;
+      usleep( 1000 );
+   }
+   return false;
+}
+
+/** @return the number of wrong counts */
+int remove_before_start( int64_t events )
+{
+   disruptor::thread t;
+   ring a, b;
+   a.add_to(t);
+   b.add_to(t);
+   t.remove_cursor( a.r );
+   t.start();
+
+   a.publish( events );
+   b.publish( events );
+   int wrong = !wait_seen( { &b }, { events } );
+   usleep( 10*1000 );
+   wrong += a.seen.load() != 0;
+   wrong += b.seen.load() != events;
+   t.stop();
+   t.join();
+   std::cout << "removed before start: " << wrong << " wrong" << std::endl;
+   return wrong;
+}
+
+/** @return the number of wrong counts */
+int remove_while_running( int64_t events )
+{
+   disruptor::thread t;
+   ring a, b, c, d;
+   a.add_to(t);
+   b.add_to(t);
+   c.add_to(t);
+   t.start();
+
+   a.publish( events );
+   b.publish( events );
+   c.publish( events );
+   int wrong = !wait_seen( { &a, &b, &c }, { events, events, events } );
+
+   t.remove_cursor( b.r );
+   // runs after the removal has been applied
+   t.async( [](){ return 0; } ).get();
+   a.publish( events );
+   b.publish( events );
+   c.publish( events );
+   wrong += !wait_seen( { &a, &c }, { 2*events, 2*events } );
+
+   // d takes over b's bell, publish one event at a time so the thread parks in between
+   d.add_to(t);
+   for( int64_t i = 0; i < 10; ++i )
+   {
+      usleep( 20*1000 );
+      d.publish( 1 );
+      b.publish( 1 );
+      wrong += !wait_seen( { &d }, { i + 1 } );
+   }
+
+   usleep( 10*1000 );
+   wrong += a.seen.load() != 2*events;
+   wrong += b.seen.load() != events;
+   wrong += c.seen.load() != 2*events;
+   wrong += d.seen.load() != 10;
+   t.stop();
+   t.join();
+   std::cout << "removed while running: " << wrong << " wrong" << std::endl;
+   return wrong;
+}
+
+int main()
+{
+   // b's ring is never read after its removal, so twice this must fit in it
+   int64_t events = 500;
+
+   int wrong = remove_before_start( events );
+   wrong += remove_while_running( events );
+   return wrong != 0;
+}
@@ -0,0 +1,86 @@
+#include <disruptor/runtime.hpp>
+#include <disruptor/affinity.hpp>
+
+namespace disruptor
+{
+
+thread_local const runtime* runtime::_current_runtime = nullptr;
+thread_local int32_t        runtime::_current_core    = -1;
+
+runtime::runtime( uint32_t cores )
+:_running(false)
+{
+   assert( cores > 0 );
+
+   for( uint32_t i = 0; i < cores * cores; ++i )
+      _mail.push_back( std::unique_ptr<mailbox>( new mailbox() ) );
+
+   for( uint32_t to = 0; to < cores; ++to )
+   {
+      _cores.push_back( std::unique_ptr<thread>( new thread() ) );
+      for( uint32_t from = 0; from < cores; ++from )
+      {
+         mailbox* m = _mail[from * cores + to].get();
+         _cores[to]->add_cursor( m->read, [m]( int64_t begin, int64_t end ) -> int64_t
+         {
+            int64_t pos = begin;
+            try
+            {
+               for( ; pos < end; ++pos )
+                  m->buffer.at(pos).call();
+            }
+            catch ( ... )
+            {
+               // like a posted functor that throws
+               m->read->set_alert( std::current_exception() );
+            }
+            return pos;
+         });
+      }
+   }
+}
+
+runtime::~runtime()
+{
+   if( _running )
+   {
+      stop();
+      join();
+   }
+}
+
+void runtime::start()
+{
+   assert( !_running && "runtime already running" );
+   _running = true;
+
+   // neighbouring cores share caches but never a physical core while
+   // there are enough of them
+   auto cpus = cpu_topology().place( size() );
+   for( uint32_t i = 0; i < size(); ++i )
+   {
+      if( cpus.size() ) _cores[i]->set_affinity( cpus[i] );
+      // the first thing each core runs, before any mail can reach it
+      _cores[i]->atomic_post( [this,i]()
+      {
+         _current_runtime = this;
+         _current_core    = int32_t(i);
+      });
+      _cores[i]->start();
+   }
+}
+
+void runtime::stop()
+{
+   for( auto itr = _cores.begin(); itr != _cores.end(); ++itr )
+      (*itr)->stop();
+}
+
+void runtime::join()
+{
+   for( auto itr = _cores.begin(); itr != _cores.end(); ++itr )
+      (*itr)->join();
+   _running = false;
+}
+
+} // namespace disruptor
@@ -0,0 +1,103 @@
+#include <disruptor/disruptor.hpp>
+#include <iostream>
+#include <thread>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+/**
+ *  Several producers claim slots of one ring through a shared_write_cursor
+ *  and publish them with publish_after(), one consumer reads them.  Every
+ *  event carries its producer and that producer's count, the consumer 
+ *  checks that each producer's events arrive in the order they were
+ *  claimed and that it never reads a slot before its producer wrote it,
+ *  which would be the case if publish_after() let a claim through ahead
+ *  of the claims before it.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+struct event
+{
+   int64_t producer;
+   int64_t count;
+};
+
+const int64_t SIZE = 1024;
+
+/** @return events per second, or 0 if the consumer saw an event out of order or unwritten */
+double run( uint32_t producers, int64_t per_producer, uint32_t batch )
+{
+   auto buffer = std::make_shared<ring_buffer<event,SIZE>>();
+   auto p      = std::make_shared<shared_write_cursor>("write",SIZE);
+   auto c      = std::make_shared<read_cursor>("read");
+   c->follows(p);
+   p->follows(c);
+   c->start_at(-1);
+
+   // the consumer clears every slot it reads
+   for( int64_t i = 0; i < SIZE; ++i ) buffer->at(i).producer = -1;
+
+   auto pub_thread = [&]( int64_t id ){
+      for( int64_t n = 0; n < per_producer; n += batch )
+      {
+         int64_t slots = std::min<int64_t>( batch, per_producer - n );
+         auto first = p->claim( slots );
+         for( int64_t i = 0; i < slots; ++i )
+         {
+            buffer->at(first + i).producer = id;
+            buffer->at(first + i).count    = n + i;
+         }
+         p->publish_after( first + slots - 1, first - 1 );
+      }
+   };
+
+   int64_t total = producers * per_producer;
+   int64_t wrong = 0;
+   std::vector<int64_t> next( producers, 0 );
+   double  start = now();
+   std::vector<std::thread> threads;
+   for( uint32_t i = 0; i < producers; ++i )
+      threads.push_back( std::thread( pub_thread, i ) );
+
+   auto pos = c->begin();
+   auto end = c->end();
+   while( pos < total )
+   {
+      if( pos == end )
+      {
+         c->publish(pos-1);
+         end = c->wait_for(end);
+      }
+      event& e = buffer->at(pos);
+      if( e.producer < 0 || e.producer >= producers || e.count != next[e.producer]++ ) 
+         ++wrong;
+      e.producer = -1;
+      ++pos;
+   }
+   c->publish(pos-1);
+   double elapsed = now() - start;
+   for( auto itr = threads.begin(); itr != threads.end(); ++itr )
+      itr->join();
+
+   if( wrong ) return 0;
+   return total / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t events = argc > 1 ? atoll( argv[1] ) : 200L * 1000L;
+
+   std::cout.precision(15);
+   for( uint32_t producers = 1; producers <= 8; producers *= 2 )
+   {
+      std::cout << producers << "P-1C claim(1):  " << run( producers, events / producers, 1 )  << " ops/secs" << std::endl;
+      std::cout << producers << "P-1C claim(16): " << run( producers, events / producers, 16 ) << " ops/secs" << std::endl;
+   }
+   return 0;
+}
@@ -0,0 +1,165 @@
+#include <disruptor/spsc.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  The 1P-1C and pingpong shapes at the cursor level, run with the 
+ *  general cursors and with the SPSC pair.  pingpong.cpp measures
+ *  thread::post, whose ring has many producers, so it cannot use the
+ *  SPSC pair and this is where the two are compared.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/**
+ *  One producer publishing every event to one consumer.
+ *  @return events per second
+ */
+template<typename Writer, typename Reader>
+double one_to_one( Writer& p, Reader& c, uint64_t iterations )
+{
+   auto source = std::make_shared<ring_buffer<int64_t,SIZE>>();
+
+   auto pub_thread = [&](){
+      auto pos = p.begin();
+      auto end = p.end();
+      for( uint64_t i = 0; i < iterations; ++i )
+      {
+         if( pos >= end )
+         {
+            end = p.wait_for(pos);
+         }
+         source->at( pos ) = i;
+         p.publish(pos);
+         ++pos;
+      }
+      p.set_eof();
+   };
+
+   int64_t sum = 0;
+   auto read_thread = [&](){
+      try
+      {
+         auto pos = c.begin();
+         auto end = c.end();
+         while( true )
+         {
+            if( pos == end )
+            {
+               c.publish(pos-1);
+               end = c.wait_for(pos);
+            }
+            sum += source->at(pos);
+            ++pos;
+         }
+      }
+      catch ( const eof& ){}
+   };
+
+   double start = now();
+   std::thread pt( pub_thread );
+   std::thread rt( read_thread );
+   pt.join();
+   rt.join();
+   return (iterations * 1.0) / (now() - start);
+}
+
+/**
+ *  Bounces a counter between two threads through a ping and a pong pair.
+ *  @return the average round trip in nanoseconds
+ */
+template<typename Writer, typename Reader>
+double round_trip( Writer& ping_w, Reader& ping_r, Writer& pong_w, Reader& pong_r, uint64_t iterations )
+{
+   auto ping = std::make_shared<ring_buffer<int64_t,SIZE>>();
+   auto pong = std::make_shared<ring_buffer<int64_t,SIZE>>();
+
+   auto echo_thread = [&](){
+      auto rpos = ping_r.begin();
+      auto rend = ping_r.end();
+      auto wpos = pong_w.begin();
+      auto wend = pong_w.end();
+      for( uint64_t i = 0; i < iterations; ++i )
+      {
+         if( rpos == rend ) rend = ping_r.wait_for(rpos);
+         auto v = ping->at(rpos);
+         ping_r.publish(rpos++);
+
+         if( wpos >= wend ) wend = pong_w.wait_for(wpos);
+         pong->at(wpos) = v;
+         pong_w.publish(wpos++);
+      }
+   };
+
+   double start = now();
+   std::thread et( echo_thread );
+
+   auto wpos = ping_w.begin();
+   auto wend = ping_w.end();
+   auto rpos = pong_r.begin();
+   auto rend = pong_r.end();
+   for( uint64_t i = 0; i < iterations; ++i )
+   {
+      if( wpos >= wend ) wend = ping_w.wait_for(wpos);
+      ping->at(wpos) = i;
+      ping_w.publish(wpos++);
+
+      if( rpos == rend ) rend = pong_r.wait_for(rpos);
+      assert( pong->at(rpos) == int64_t(i) );
+      pong_r.publish(rpos++);
+   }
+   et.join();
+   return (now() - start) * 1000000000.0 / iterations;
+}
+
+int main( int argc, char** argv )
+{
+   uint64_t iterations = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 100;
+   uint64_t trips      = argc > 2 ? atoll( argv[2] ) : 1000L * 1000L;
+   std::cout.precision(15);
+
+   {
+      auto p = std::make_shared<write_cursor>("write",SIZE);
+      auto c = std::make_shared<read_cursor>("read");
+      c->start_at(-1);
+      c->follows(p);
+      p->follows(c);
+      std::cout << "1P-1C cursor performance: " << one_to_one( *p, *c, iterations ) << " ops/secs" << std::endl;
+   }
+   {
+      spsc_write_cursor p(SIZE);
+      spsc_read_cursor  c(p);
+      std::cout << "1P-1C spsc performance:   " << one_to_one( p, c, iterations ) << " ops/secs" << std::endl;
+   }
+   {
+      auto ping_w = std::make_shared<write_cursor>("ping",SIZE);
+      auto ping_r = std::make_shared<read_cursor>("ping");
+      auto pong_w = std::make_shared<write_cursor>("pong",SIZE);
+      auto pong_r = std::make_shared<read_cursor>("pong");
+      ping_r->start_at(-1);
+      pong_r->start_at(-1);
+      ping_r->follows(ping_w);
+      ping_w->follows(ping_r);
+      pong_r->follows(pong_w);
+      pong_w->follows(pong_r);
+      std::cout << "pingpong cursor round trip: " << round_trip( *ping_w, *ping_r, *pong_w, *pong_r, trips ) << " ns" << std::endl;
+   }
+   {
+      spsc_write_cursor ping_w(SIZE);
+      spsc_read_cursor  ping_r(ping_w);
+      spsc_write_cursor pong_w(SIZE);
+      spsc_read_cursor  pong_r(pong_w);
+      std::cout << "pingpong spsc round trip:   " << round_trip( ping_w, ping_r, pong_w, pong_r, trips ) << " ns" << std::endl;
+   }
+   return 0;
+}
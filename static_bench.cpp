@@ -0,0 +1,132 @@
+#include <disruptor/static_topology.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  The diamond from test.cpp: P publishes, A and B both read behind P and
+ *  C reads behind A and B and gates P.  It is run once wired up at run
+ *  time with read_cursor and write_cursor and once declared as a
+ *  static_topology, and C checks every result in both.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+struct P; struct A; struct B; struct C;
+typedef static_topology< SIZE,
+                         writer<P, C>,
+                         reader<A, P>,
+                         reader<B, P>,
+                         reader<C, A, B> > diamond;
+
+struct rings
+{
+   ring_buffer<uint64_t,SIZE> source;
+   ring_buffer<uint64_t,SIZE> square;
+   ring_buffer<uint64_t,SIZE> cube;
+};
+
+template<typename Writer>
+void publish_all( Writer& p, rings& r, uint64_t iterations )
+{
+   auto pos = p.begin();
+   auto end = p.end();
+   for( uint64_t i = 0; i < iterations; ++i )
+   {
+      if( pos >= end )
+      {
+         end = p.wait_for(pos);
+      }
+      r.source.at(pos) = i;
+      p.publish(pos);
+      ++pos;
+   }
+   p.set_eof();
+}
+
+/** reads until eof, calling f for each position */
+template<typename Reader, typename Functor>
+void read_all( Reader& c, Functor&& f )
+{
+   try
+   {
+      auto pos = c.begin();
+      auto end = c.end();
+      while( true )
+      {
+         if( pos == end )
+         {
+            c.publish(pos-1);
+            end = c.wait_for(pos);
+         }
+         f(pos);
+         ++pos;
+      }
+   }
+   catch ( const eof& ){}
+}
+
+/** @return events per second, or 0 if C did not see every result */
+template<typename PC, typename AC, typename BC, typename CC>
+double run( PC& p, AC& a, BC& b, CC& c, uint64_t iterations )
+{
+   auto r = std::make_shared<rings>();
+
+   uint64_t count = 0;
+   bool     right = true;
+   double   start = now();
+   std::thread at( [&](){ read_all( a, [&]( int64_t pos ){ auto v = r->source.at(pos); r->square.at(pos) = v * v; } ); } );
+   std::thread bt( [&](){ read_all( b, [&]( int64_t pos ){ auto v = r->source.at(pos); r->cube.at(pos) = v * v * v; } ); } );
+   std::thread ct( [&](){ read_all( c, [&]( int64_t pos ){
+                                          uint64_t v = count++;
+                                          right &= r->cube.at(pos) - r->square.at(pos) == v * v * v - v * v; } ); } );
+   std::thread pt( [&](){ publish_all( p, *r, iterations ); } );
+   pt.join();
+   at.join();
+   bt.join();
+   ct.join();
+   double elapsed = now() - start;
+
+   if( !right || count != iterations ) return 0;
+   return iterations / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   uint64_t iterations = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 50;
+
+   std::cout.precision(15);
+   for( int i = 0; i < 2; ++i )
+   {
+      {
+         auto p = std::make_shared<write_cursor>("p",SIZE);
+         auto a = std::make_shared<read_cursor>("a");
+         auto b = std::make_shared<read_cursor>("b");
+         auto c = std::make_shared<read_cursor>("c");
+         a->follows(p);
+         b->follows(p);
+         c->follows(a);
+         c->follows(b);
+         p->follows(c);
+         a->start_at(-1);
+         b->start_at(-1);
+         c->start_at(-1);
+         std::cout << "diamond with barrier:        " << run( *p, *a, *b, *c, iterations ) << " ops/secs" << std::endl;
+      }
+      {
+         auto d = std::make_shared<diamond>();
+         std::cout << "diamond with static_barrier: "
+                   << run( d->get<P>(), d->get<A>(), d->get<B>(), d->get<C>(), iterations ) << " ops/secs" << std::endl;
+      }
+   }
+   return 0;
+}
@@ -1,4 +1,5 @@
 #include <disruptor/disruptor.hpp>
+#include <disruptor/affinity.hpp>
 #include <thread>
 #include <stdexcept>
 #include <iostream>
@@ -156,6 +157,16 @@ int main( int argc, char** argv )
    std::thread at( thread_a );
    std::thread bt( thread_b );
    std::thread ct( thread_c );
+
+   // keep the stages on neighbouring cores rather than wherever the os puts them
+   auto cpus = cpu_topology().place( 4 );
+   if( cpus.size() )
+   {
+      pin_thread( pt.native_handle(), cpus[0] );
+      pin_thread( at.native_handle(), cpus[1] );
+      pin_thread( bt.native_handle(), cpus[2] );
+      pin_thread( ct.native_handle(), cpus[3] );
+   }
     struct timeval start_time, end_time;
     gettimeofday(&start_time, NULL);
 
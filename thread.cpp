@@ -1,99 +1,712 @@
 #include <disruptor/thread.hpp>
+#include <disruptor/affinity.hpp>
 #include <boost/thread.hpp>
+#include <chrono>
+#include <unordered_map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace disruptor
 {
 
+namespace detail
+{
+   /** a cheap, monotonic on current hardware, count of cycles */
+   inline uint64_t cycles()
+   {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>( 
+                  std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+   }
+
+   /** @return how many cycles() pass in ns, measured once against the steady clock */
+   uint64_t cycles_in( int64_t ns )
+   {
+      static const double per_ns = []() -> double
+      {
+         auto     start = std::chrono::steady_clock::now();
+         uint64_t c     = cycles();
+         auto     took  = std::chrono::nanoseconds(0);
+         while( took < std::chrono::microseconds(200) )
+            took = std::chrono::steady_clock::now() - start;
+         return double( cycles() - c ) / took.count();
+      }();
+      return uint64_t( per_ns * ns );
+   }
+
+   class thread_impl;
+
+   /** the thread_impl whose run loop is running on this thread, if any */
+   static thread_local const thread_impl* current_impl = nullptr;
+}
+
 struct cursor_handler
 {
+   /** how long one batch of a handler may take before its batch limit shrinks */
+   static const int64_t      turn_target_ns  = 50*1000;
+   static const int64_t      max_batch_limit = 4096;
+
    int64_t                   pos;
    int64_t                   end;
    int64_t                   max_batch;
+   /** the waiter's bell rung by the cursors cur follows, or -1 if polled */
+   int32_t                   bell;
+   /** a turn may take weight times the turn target */
+   uint32_t                  weight;
    read_cursor_ptr           cur;
-   thread::handler           call;
+   detail::handler_ref       call;
+   /** called with [pos,pos) once a burst is processed, may be empty */
+   detail::handler_ref       drained;
+   /** true if events were processed since drained was last called */
+   bool                      undrained;
+
+   /** usage since the handler was added */
+   uint64_t                  used_cycles;
+   int64_t                   events;
+   uint32_t                  preemptions;
 
+   /** 
+    *  The position cur was last published at, read in place of cur by 
+    *  the handlers of this thread that follow it.
+    */
+   int64_t                   published;
+   /** 
+    *  When every cursor cur follows is published on this thread, their
+    *  published positions, otherwise empty and cur is checked through 
+    *  its barrier.
+    */
+   std::vector<const int64_t*> sources;
+   /** cur->followed_changes() when sources was filled in */
+   uint32_t                  linked_changes;
+   /** the bells of the handlers of this thread that have cur as a source */
+   std::vector<int32_t>      followers;
+   /** true while bell is registered with the cursors cur follows */
+   bool                      woken;
 
-   cursor_handler( read_cursor_ptr c, thread::handler h )
+
+   cursor_handler( read_cursor_ptr c, detail::handler_ref&& h, uint32_t w = 1, 
+                   detail::handler_ref&& d = detail::handler_ref() )
    :pos(c->begin()),
     end(c->end()),
-    max_batch(10),cur(c),call(h){}
+    max_batch(10),bell(-1),weight(std::max<uint32_t>(w,1)),cur(std::move(c)),call(std::move(h)),
+    drained(std::move(d)),undrained(false),
+    used_cycles(0),events(0),preemptions(0),
+    published(cur->pos().aquire()),linked_changes(cur->followed_changes()),woken(false){}
+
+   /** 
+    *  @param relink - set if cur started or stopped following a cursor 
+    *         since sources was filled in, until then it is checked through
+    *         its barrier
+    *  @return one past the last event the handler may process 
+    */
+   int64_t check_end( bool& relink )
+   {
+      if( cur->followed_changes() != linked_changes )
+      {
+         relink = true;
+         return cur->check_end();
+      }
+      if( sources.empty() ) return cur->check_end();
+      int64_t min_pos = *sources[0];
+      for( size_t i = 1; i < sources.size(); ++i ) 
+         min_pos = std::min( min_pos, *sources[i] );
+      return min_pos + 1;
+   }
+
+   /**
+    *  Gives the handler a turn: calls it with batches of up to max_batch
+    *  of the available events until it drains the events, stops short of
+    *  a batch or uses up its budget of weight times the turn target.  A
+    *  handler over budget is preempted at the end of its batch and picks
+    *  up on the next sweep.  before() is called ahead of each batch, if 
+    *  it returns true it did work of its own that is not timed.
+    *
+    *  Each batch is timed with one read of the cycle counter, now is the
+    *  reading that the batch starts from and is left at the reading it 
+    *  ended on.  The limit doubles while the handler finishes whole batches
+    *  well inside the turn target and halves when a batch runs over it.  A
+    *  burst is drained in ever larger batches while an expensive handler
+    *  is kept from holding the thread for long.
+    *
+    *  @return the first unprocessed event
+    */
+   template<typename Before>
+   int64_t dispatch( uint64_t turn_cycles, uint64_t& now, Before&& before )
+   {
+      const uint64_t budget = weight * turn_cycles;
+      uint64_t       turn   = 0;
+      int64_t        p      = pos;
+      while( true )
+      {
+         if( before() ) now = detail::cycles();
+         int64_t  limit = std::min( end, p + max_batch );
+         int64_t  next  = call( p, limit );
+         uint64_t prev  = now;
+         now   = detail::cycles();
+         turn += now - prev;
+
+         if( limit < end )
+         {
+            if( now - prev > turn_cycles )
+               max_batch = std::max<int64_t>( max_batch / 2, 1 );
+            else if( next == limit && now - prev < turn_cycles / 2 )
+               max_batch = std::min( max_batch * 2, max_batch_limit );
+         }
+         p = next;
+         if( next < limit || p == end ) break;
+         if( turn >= budget ) { ++preemptions; break; }
+      }
+      used_cycles += turn;
+      events      += p - pos;
+      return p;
+   }
+
+};
 
+const int64_t cursor_handler::turn_target_ns;
+const int64_t cursor_handler::max_batch_limit;
+
+/** a writer declared with thread::add_local_writer() */
+struct local_writer
+{
+   local_writer( std::shared_ptr<const event_cursor> c )
+   :cursor(std::move(c)),seen(cursor->pos().aquire()){}
+
+   std::shared_ptr<const event_cursor> cursor;
+   /** the position of cursor as of the start of the last sweep */
+   int64_t                             seen;
+   std::vector<int32_t>                followers;
+};
+
+struct fd_entry
+{
+   fd_entry( int f, detail::handler_ref&& h ):fd(f),call(std::move(h)){}
+
+   int                   fd;
+   detail::handler_ref   call;
 };
 
 namespace detail {
 class thread_impl
 {
    public:
+      thread_impl():_done(true),_running(false),_high_pos(0),_high_end(0),_high_weight(0),_cpu(-1),_relink(false),_ready_words(0),_next_bell(0),
+                    _turn_cycles( detail::cycles_in( cursor_handler::turn_target_ns ) ),_now(0),_epoll_fd(-1)
+      {
+         for( int i = 0; i < waiter::words; ++i ) _ready[i] = 0;
+      }
+      ~thread_impl() { if( _epoll_fd >= 0 ) ::close( _epoll_fd ); }
+
+      /** @return true if called from the run loop of this thread */
+      bool on_thread()const { return current_impl == this; }
+
       thread*                        _self;
       std::unique_ptr<boost::thread> _thread;
-      bool                           _done;
+      /** set by stop(), the run loop checks it once per sweep */
+      std::atomic<bool>              _done;
+      /** 
+       *  True from start() until join() returns.  Until start() and after
+       *  join() other threads may change _handlers and the rest directly,
+       *  in between changes are posted to the run loop.
+       */
+      std::atomic<bool>              _running;
       std::vector<cursor_handler>    _handlers;
       read_cursor_ptr                _read_post_cursor;
 
+      /** 
+       *  The high priority post lane is read here rather than by a 
+       *  cursor_handler so that it can be drained before every batch.
+       */
+      read_cursor_ptr                _read_high_cursor;
+      int64_t                        _high_pos;
+      int64_t                        _high_end;
+      /** the most high priority functors run per batch, 0 for all */
+      uint32_t                       _high_weight;
+
+      /** the cpu to pin to as the thread starts, or -1 */
+      int                            _cpu;
+
+      /** parked on when no handler has work, woken by the cursors they follow */
+      std::shared_ptr<waiter>        _waiter;
+
+      /** 
+       *  Handlers added or removed by posted functors, applied between 
+       *  sweeps because the sweep holds references into _handlers.
+       */
+      std::vector<cursor_handler>    _added;
+      std::vector<read_cursor_ptr>   _removed;
+      std::vector<local_writer>      _added_writers;
+
+      std::vector<local_writer>      _local_writers;
+      /** set when a handler's cursor changed what it follows since link() */
+      bool                           _relink;
+
+      /** 
+       *  Each handler gets one of the waiter's bells and a sweep only
+       *  visits handlers whose bell rang, or that still had work on the
+       *  last sweep.  Handlers beyond waiter::max_bells are polled.
+       */
+      uint64_t                       _ready[waiter::words];
+      uint64_t                       _ready_words;
+      std::vector<int32_t>           _by_bell;
+      std::vector<uint32_t>          _polled;
+      std::vector<int32_t>           _free_bells;
+      int32_t                        _next_bell;
+
+      uint64_t                       _turn_cycles;
+      /** 
+       *  The last reading of the cycle counter.  Turns follow each other
+       *  during a sweep, so one reading ends a batch and starts the next.
+       */
+      uint64_t                       _now;
+
+      /** 
+       *  Created with the first fd handler, the waiter's fd is part of the
+       *  set with a null data pointer so that parking blocks in epoll.
+       */
+      int                                                  _epoll_fd;
+      std::unordered_map<int,std::unique_ptr<fd_entry>>   _fds;
+
+      void add_fd( int fd, uint32_t events, detail::handler_ref&& h )
+      {
+         if( _epoll_fd < 0 )
+         {
+            _epoll_fd = ::epoll_create1( EPOLL_CLOEXEC );
+            if( _epoll_fd < 0 ) throw std::system_error( errno, std::system_category(), "epoll_create1" );
+            epoll_event ev;
+            ev.events   = EPOLLIN;
+            ev.data.ptr = nullptr;
+            ::epoll_ctl( _epoll_fd, EPOLL_CTL_ADD, _waiter->fd(), &ev );
+         }
+         std::unique_ptr<fd_entry> entry( new fd_entry( fd, std::move(h) ) );
+         epoll_event ev;
+         ev.events   = events;
+         ev.data.ptr = entry.get();
+         if( ::epoll_ctl( _epoll_fd, EPOLL_CTL_ADD, fd, &ev ) != 0 ) 
+            throw std::system_error( errno, std::system_category(), "epoll_ctl" );
+         _fds[fd] = std::move(entry);
+      }
+
+      void remove_fd( int fd )
+      {
+         auto itr = _fds.find( fd );
+         if( itr == _fds.end() ) return;
+         ::epoll_ctl( _epoll_fd, EPOLL_CTL_DEL, fd, nullptr );
+         _fds.erase( itr );
+      }
+
+      /** 
+       *  Dispatches ready fds, blocking up to timeout_ms.  
+       *  @return the number of fd handlers called 
+       */
+      int poll_fds( int timeout_ms )
+      {
+         epoll_event events[64];
+         int n = ::epoll_wait( _epoll_fd, events, 64, timeout_ms );
+         int called = 0;
+         try
+         {
+            for( int i = 0; i < n; ++i )
+            {
+               auto entry = (fd_entry*)events[i].data.ptr;
+               if( !entry ) { _waiter->drain(); continue; }
+               ++called;
+               entry->call( entry->fd, events[i].events );
+            }
+         }
+         catch ( ... )
+         {
+            // like a posted functor that throws
+            _read_post_cursor->set_alert( std::current_exception() );
+         }
+         return called;
+      }
+
+      std::vector<thread::handler_usage> usage()const
+      {
+         uint64_t total = 0;
+         for( auto itr = _handlers.begin(); itr != _handlers.end(); ++itr )
+            total += itr->used_cycles;
+
+         std::vector<thread::handler_usage> u;
+         u.reserve( _handlers.size() );
+         for( auto itr = _handlers.begin(); itr != _handlers.end(); ++itr )
+         {
+            thread::handler_usage h;
+            h.cursor      = itr->cur;
+            h.weight      = itr->weight;
+            h.events      = itr->events;
+            h.preemptions = itr->preemptions;
+            h.share       = total ? double( itr->used_cycles ) / total : 0;
+            u.push_back( std::move(h) );
+         }
+         return u;
+      }
+
+      /** @return true if any high priority functor ran */
+      bool run_high()
+      {
+         if( _high_pos == _high_end )
+         {
+            _high_end = _read_high_cursor->check_end();
+            if( _high_pos == _high_end ) return false;
+         }
+         int64_t end = _high_weight ? std::min<int64_t>( _high_end, _high_pos + _high_weight ) : _high_end;
+         try
+         {
+            while( _high_pos < end )
+               _self->high_post_buffer.at(_high_pos++).call();
+         }
+         catch ( ... )
+         {
+            // like a posted functor that throws
+            _read_post_cursor->set_alert( std::current_exception() );
+         }
+         _read_high_cursor->publish( _high_pos - 1 );
+         return true;
+      }
+
+      void mark_ready( int32_t bell )
+      {
+         _ready[bell / 64] |= uint64_t(1) << (bell % 64);
+         _ready_words      |= uint64_t(1) << (bell / 64);
+      }
+
+      bool changes_pending()const
+      {
+         return _added.size() || _removed.size() || _added_writers.size() || _relink;
+      }
+
+      void apply_changes()
+      {
+         for( auto itr = _added.begin(); itr != _added.end(); ++itr )
+         {
+            if( _free_bells.size() )                   { itr->bell = _free_bells.back(); _free_bells.pop_back(); }
+            else if( _next_bell < waiter::max_bells )  { itr->bell = _next_bell++; }
+            // it may have work already
+            if( itr->bell >= 0 ) mark_ready( itr->bell );
+         }
+         _handlers.insert( _handlers.end(), std::make_move_iterator( _added.begin() ),
+                                            std::make_move_iterator( _added.end() ) );
+         _added.clear();
+         _local_writers.insert( _local_writers.end(), std::make_move_iterator( _added_writers.begin() ),
+                                                      std::make_move_iterator( _added_writers.end() ) );
+         _added_writers.clear();
+
+         for( auto itr = _removed.begin(); itr != _removed.end(); ++itr )
+         {
+            const read_cursor_ptr& c = *itr;
+            // unlike remove_if this leaves the removed handlers intact at
+            // the end, their waiter and bell are released before erasing
+            auto end = std::stable_partition( _handlers.begin(), _handlers.end(),
+                                              [&]( const cursor_handler& h ) { return h.cur != c; } );
+            for( auto h = end; h != _handlers.end(); ++h )
+            {
+               if( h->woken ) h->cur->stop_wake_on_progress( _waiter, h->bell );
+               if( h->bell >= 0 ) _free_bells.push_back( h->bell );
+            }
+            _handlers.erase( end, _handlers.end() );
+         }
+         _removed.clear();
+
+         _by_bell.assign( _next_bell, -1 );
+         _polled.clear();
+         for( uint32_t i = 0; i < _handlers.size(); ++i )
+         {
+            if( _handlers[i].bell >= 0 ) _by_bell[_handlers[i].bell] = i;
+            else                         _polled.push_back( i );
+         }
+         _relink = false;
+         link();
+      }
+
+      /**
+       *  Splits the handlers into those whose sources are all published
+       *  on this thread, which are handed their sources' positions and 
+       *  marked ready by them, and the rest, whose bells are rung by the
+       *  cursors they follow.  Called whenever handlers move or a 
+       *  handler's cursor changes what it follows.
+       */
+      void link()
+      {
+         struct source
+         {
+            const int64_t*        pos;
+            std::vector<int32_t>* followers;
+         };
+         std::unordered_map<const event_cursor*,source> local;
+         for( auto h = _handlers.begin(); h != _handlers.end(); ++h )
+         {
+            h->followers.clear();
+            source s = { &h->published, &h->followers };
+            local[h->cur.get()] = s;
+         }
+         for( auto w = _local_writers.begin(); w != _local_writers.end(); ++w )
+         {
+            w->followers.clear();
+            source s = { &w->seen, &w->followers };
+            local[w->cursor.get()] = s;
+         }
+
+         for( auto h = _handlers.begin(); h != _handlers.end(); ++h )
+         {
+            // read first, so a change while linking is caught by check_end()
+            h->linked_changes = h->cur->followed_changes();
+            auto followed = h->cur->followed();
+            h->sources.clear();
+            for( auto f = followed.begin(); f != followed.end(); ++f )
+            {
+               auto l = local.find( f->get() );
+               if( l == local.end() || f->get() == h->cur.get() ) break;
+               h->sources.push_back( l->second.pos );
+            }
+            if( h->sources.size() != followed.size() ) h->sources.clear();
+
+            if( h->sources.size() )
+            {
+               for( auto f = followed.begin(); f != followed.end(); ++f )
+                  if( h->bell >= 0 ) local[f->get()].followers->push_back( h->bell );
+               if( !h->woken ) continue;
+               h->cur->stop_wake_on_progress( _waiter, h->bell );
+               h->woken = false;
+            }
+            else
+            {
+               if( h->woken ) continue;
+               h->cur->wake_on_progress( _waiter, h->bell );
+               h->woken = true;
+            }
+            // progress may have been missed while it changed over
+            if( h->bell >= 0 ) mark_ready( h->bell );
+         }
+      }
+
+      /** 
+       *  Publishes the progress of a drained handler or gives it a batch.
+       *  @return true if the handler had work, so should be visited again
+       */
+      bool serve( cursor_handler& current, bool& progress )
+      {
+         if( current.pos == current.end )
+         {
+            // caught up, flush before the events are released even if
+            // more have arrived since, which start the next burst
+            if( current.undrained )
+            {
+               current.undrained = false;
+               current.drained( current.pos, current.end );
+               uint64_t now = detail::cycles();
+               current.used_cycles += now - _now;
+               _now = now;
+            }
+            current.cur->publish( current.pos - 1 );
+            if( current.published != current.pos - 1 )
+            {
+               current.published = current.pos - 1;
+               for( auto f = current.followers.begin(); f != current.followers.end(); ++f )
+                  mark_ready( *f );
+            }
+            current.end = current.check_end( _relink );
+         }
+         if( current.pos >= current.end ) return false;
+
+         // control messages go ahead of every batch
+         auto next = current.dispatch( _turn_cycles, _now, [&]() -> bool
+         { 
+            if( !run_high() ) return false;
+            progress = true;
+            return true;
+         });
+         if( next > current.pos )
+         {
+            current.pos       = next;
+            current.undrained = bool(current.drained);
+            progress          = true;
+         }
+         return true;
+      }
+
+      /** 
+       *  Visits the handlers that are ready and those that are polled.
+       *  @return true if any made progress 
+       */
+      bool sweep()
+      {
+         bool progress = false;
+         for( auto w = _local_writers.begin(); w != _local_writers.end(); ++w )
+         {
+            int64_t p = w->cursor->pos().aquire();
+            if( p == w->seen ) continue;
+            w->seen = p;
+            for( auto f = w->followers.begin(); f != w->followers.end(); ++f )
+               mark_ready( *f );
+         }
+         _ready_words |= _waiter->take( _ready );
+
+         uint64_t words = _ready_words;
+         _ready_words   = 0;
+         for( ; words; words &= words - 1 )
+         {
+            int      w    = __builtin_ctzll( words );
+            uint64_t bits = _ready[w];
+            _ready[w]     = 0;
+            for( ; bits; bits &= bits - 1 )
+            {
+               int32_t bell = w * 64 + __builtin_ctzll( bits );
+               int32_t i    = _by_bell[bell];
+               if( i >= 0 && serve( _handlers[i], progress ) ) mark_ready( bell );
+            }
+         }
+         for( auto itr = _polled.begin(); itr != _polled.end(); ++itr )
+            serve( _handlers[*itr], progress );
+         return progress;
+      }
+
+
+      /** 
+       *  Refreshes every handler, which also catches cursors whose sources
+       *  were followed after they were added and so never ring.
+       *
+       *  @return true if none of them has work 
+       */
+      bool idle()
+      {
+         if( changes_pending() ) return false;
+         if( _ready_words || _waiter->rung() ) return false;
+         if( _self->_timers.size() && _self->_timers.next_expiry() <= thread::now_tick() ) return false;
+         if( _high_pos < (_high_end = _read_high_cursor->check_end()) ) return false;
+         for( uint32_t i = 0; i < _handlers.size(); ++i )
+         {
+            cursor_handler& h = _handlers[i];
+            if( h.pos < (h.end = h.cur->check_end()) ) 
+            {
+               if( h.bell >= 0 ) mark_ready( h.bell );
+               return false;
+            }
+         }
+         return true;
+      }
+
+      /** @return true if any timer ran */
+      bool run_timers()
+      {
+         try
+         {
+            return _self->_timers.advance( thread::now_tick() ) > 0;
+         }
+         catch ( ... )
+         {
+            // like a posted functor that throws
+            _read_post_cursor->set_alert( std::current_exception() );
+            return true;
+         }
+      }
+
+      /** @return how many ms the thread may park for */
+      int park_timeout()const
+      {
+         int64_t next = _self->_timers.next_expiry();
+         if( next == 0x7fffffffffffffff ) return 40;
+         int64_t ms = (next - thread::now_tick()) * thread::tick_ns / (1000*1000);
+         return int( std::max<int64_t>( 0, std::min<int64_t>( ms, 40 ) ) );
+      }
 
       void run()
       {
          uint64_t spin_count = 0;
+         _now = detail::cycles();
          while( !_done )
          {
              bool inc_spin = true;
-             for( uint32_t i = 0; i < _handlers.size(); ++i )
+             bool swept    = sweep();
+             if( swept )
              {
-                 cursor_handler& current = _handlers[i];
-                 if( current.pos == current.end )
-                 {
-                     current.cur->publish( current.pos - 1 );
-                     current.end = current.cur->check_end();
-                 }
-                 if( current.pos < current.end )
-                 {
-                    auto next = current.call( current.pos, 
-                                              std::min(current.end, 
-                                                       current.pos+current.max_batch) );
-                    if( next > current.pos )
-                    {
-                       // we made progress
-                       current.pos   = next;
-                       inc_spin      = false;
-                       spin_count    = 0;
-                    }
-                 }
+                inc_spin   = false;
+                spin_count = 0;
+             }
+             bool other = run_high();
+             if( _epoll_fd >= 0 && poll_fds( 0 ) )                other = true;
+             if( _self->_timers.size() && run_timers() )         other = true;
+             if( other )
+             {
+                inc_spin   = false;
+                spin_count = 0;
              }
              spin_count += inc_spin;
 
-             // progress backoff... until a maximum of 10 ms 
-             if( spin_count > 1000 ) usleep( std::min<int64_t>( spin_count >> 4,  40*1000) );
+             if( changes_pending() ) 
+                apply_changes();
+
+             // like the barrier, back off from spinning to yielding, which
+             // lets a producer sharing the core run, and after a while park
+             // until a followed cursor publishes or the next timer is due,
+             // the 40 ms limit covers producers that were not followed yet
+             // when their handler was added.
+             if( spin_count > 100 && spin_count <= 1000 ) 
+                boost::this_thread::yield();
+             else if( spin_count > 1000 ) 
+             {
+                _waiter->prepare_park();
+                if( !idle() || _done )  _waiter->cancel_park();
+                else if( _epoll_fd < 0 ) _waiter->park( park_timeout() );
+                else 
+                {
+                   if( poll_fds( park_timeout() ) ) spin_count = 0;
+                   _waiter->finish_park();
+                }
+             }
+
+             // only a sweep that did nothing but turns leaves _now current
+             if( !swept || other ) _now = detail::cycles();
          }
       }
 
 };
 } // namespace detail
 
+const int64_t thread::tick_ns;
+
 thread::thread()
-:my( new detail::thread_impl() )
+:_timers( now_tick() ),my( new detail::thread_impl() )
 {
-   my->_self = this;
-   my->_done = true;
+   my->_self   = this;
+   my->_waiter = std::make_shared<waiter>();
 
    my->_read_post_cursor = std::make_shared<read_cursor>();
    post_cursor      = std::make_shared<shared_write_cursor>(post_buffer.get_buffer_size());
 
    post_cursor->follows( my->_read_post_cursor );
    my->_read_post_cursor->follows( post_cursor );
+   // nothing is read yet, posts made before start() must not wrap onto slot 0
+   my->_read_post_cursor->start_at( -1 );
+
+   my->_read_high_cursor = std::make_shared<read_cursor>();
+   high_post_cursor      = std::make_shared<shared_write_cursor>(high_post_buffer.get_buffer_size());
+   high_post_cursor->follows( my->_read_high_cursor );
+   my->_read_high_cursor->follows( high_post_cursor );
+   my->_read_high_cursor->start_at( -1 );
+   my->_read_high_cursor->wake_on_progress( my->_waiter );
+   my->_high_pos = my->_high_end = my->_read_high_cursor->begin();
 
    add_cursor( my->_read_post_cursor, 
-      [=]( int64_t begin, int64_t end )  -> int64_t 
+      [this]( int64_t begin, int64_t end )  -> int64_t 
       {
+         // drain everything we were given before the cursor is revisited
+         int64_t pos = begin;
          try
          {
-            post_buffer.at(begin).call();
-            return begin + 1;
+            for( ; pos < end; ++pos )
+               post_buffer.at(pos).call();
          } 
          catch ( ... ) 
          {
             my->_read_post_cursor->set_alert( std::current_exception() );
-            return begin;
          }
+         return pos;
       });
 }
 
@@ -101,27 +714,133 @@ thread::~thread()
 {
 }
 
-void thread::add_cursor( read_cursor_ptr c, handler h  )
+void thread::add_handler( read_cursor_ptr c, detail::handler_ref&& h, uint32_t weight, 
+                          detail::handler_ref&& drained )
+{
+   if( !my->_running.load() )
+   {
+      my->_added.push_back( cursor_handler( std::move(c), std::move(h), weight, std::move(drained) ) );
+      my->apply_changes();
+      return;
+   }
+   auto added = new cursor_handler( std::move(c), std::move(h), weight, std::move(drained) );
+   atomic_post( [=]() 
+   { 
+      my->_added.push_back( std::move(*added) ); 
+      delete added;
+   } );
+}
+
+void thread::remove_cursor( read_cursor_ptr c )
+{
+   if( !my->_running.load() )
+   {
+      my->_removed.push_back( c );
+      my->apply_changes();
+      return;
+   }
+   auto removed = new read_cursor_ptr( std::move(c) );
+   atomic_post( [=]() 
+   { 
+      my->_removed.push_back( std::move(*removed) ); 
+      delete removed;
+   } );
+}
+
+bool thread::owned_here()const
+{
+   return !my->_running.load() || my->on_thread();
+}
+
+std::vector<thread::handler_usage> thread::usage()
+{
+   if( owned_here() )
+      return my->usage();
+   return async( [this]() { return my->usage(); } ).get();
+}
+
+void thread::add_local_writer( std::shared_ptr<const event_cursor> w )
+{
+   if( !my->_running.load() )
+   {
+      my->_added_writers.push_back( local_writer( std::move(w) ) );
+      my->apply_changes();
+      return;
+   }
+   auto added = new local_writer( std::move(w) );
+   atomic_post( [=]() 
+   { 
+      my->_added_writers.push_back( std::move(*added) ); 
+      delete added;
+   } );
+}
+
+void thread::add_fd_handler( int fd, uint32_t events, detail::handler_ref&& h )
+{
+   if( !my->_running.load() )
+   {
+      my->add_fd( fd, events, std::move(h) );
+      return;
+   }
+   auto added = new detail::handler_ref( std::move(h) );
+   atomic_post( [=]() 
+   { 
+      std::unique_ptr<detail::handler_ref> h( added );
+      my->add_fd( fd, events, std::move(*h) ); 
+   } );
+}
+
+void thread::remove_fd( int fd )
+{
+   if( !my->_running.load() )
+   {
+      my->remove_fd( fd );
+      return;
+   }
+   atomic_post( [=]() { my->remove_fd( fd ); } );
+}
+
+void thread::set_high_priority_weight( uint32_t n )
+{
+   assert( !my->_running.load() && "the weight must be set before start()" );
+   my->_high_weight = n;
+}
+
+void thread::set_affinity( int cpu )
 {
-   assert( my->_done && "handlers must be added before starting the thread" );
-   my->_handlers.push_back( cursor_handler( c, h ) );
+   if( !my->_running.load() )
+   {
+      my->_cpu = cpu;
+      return;
+   }
+   atomic_post( [=]() { pin_current_thread( cpu ); } );
 }
 
 void thread::start()
 {
-   assert( my->_done && "thread already running" );
-   my->_done = false;
-   my->_thread.reset( new boost::thread( [=](){ my->run(); } ) );
+   assert( !my->_running.load() && "thread already running" );
+   // from here on other threads post their changes
+   my->_running = true;
+   my->_done    = false;
+   my->_thread.reset( new boost::thread( [=]()
+   { 
+      detail::current_impl = my.get();
+      if( my->_cpu >= 0 ) pin_current_thread( my->_cpu );
+      my->run(); 
+      detail::current_impl = nullptr;
+   } ) );
 }
 
 void thread::stop()
 {
    my->_done = true;
+   my->_waiter->wake();
 }
 void thread::join()
 {
    assert( my->_thread );
    my->_thread->join();
+   my->_running = false;
 }
 
 
@@ -0,0 +1,90 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <random>
+
+using namespace disruptor;
+
+/**
+ *  Checks the timer wheel against what a sorted list of deadlines would
+ *  do: random timers, some past the wheel's 2^24 tick span, random
+ *  cancels and uneven advances, and every timer must run exactly on its
+ *  tick unless it was cancelled.  Then measures how late timers posted
+ *  to a thread run.
+ */
+
+typedef detail::timer_wheel<detail::functor> wheel;
+
+/** @return the number of timers that ran off their tick, more than once or not at all */
+int64_t check_wheel( int64_t timers )
+{
+   wheel   w(1000);
+   int64_t wrong = 0, cancelled = 0;
+
+   std::mt19937_64                              rng(7);
+   std::vector<int64_t>                         runs( timers, 0 );
+   std::vector<std::pair<wheel::handle,bool>>   handles;
+   for( int64_t i = 0; i < timers; ++i )
+   {
+      int64_t expires = w.now() + 1 + ( rng() % 4 == 0 ? rng() % (1 << 25) : rng() % 300 );
+      handles.push_back( std::make_pair( w.add( expires, [&,i,expires](){
+                                                   wrong += w.now() != expires;
+                                                   ++runs[i]; } ), false ) );
+      if( rng() % 10 == 0 )
+      {
+         auto& h = handles[ rng() % handles.size() ];
+         if( w.cancel( h.first ) )
+         {
+            wrong += h.second;
+            h.second = true;
+            ++cancelled;
+         }
+      }
+      if( rng() % 3 == 0 ) w.advance( w.now() + rng() % 50 );
+   }
+   while( w.size() ) w.advance( std::max( w.next_expiry(), w.now() + 1 ) );
+
+   for( int64_t i = 0; i < timers; ++i )
+      wrong += runs[i] != (handles[i].second ? 0 : 1);
+   std::cout << timers << " timers, " << cancelled << " cancelled, " << wrong << " wrong" << std::endl;
+   return wrong;
+}
+
+/** @return the most any of count timers ran late in microseconds, or -1 if one ran early */
+int64_t thread_lateness( int count )
+{
+   typedef thread::clock clock;
+
+   disruptor::thread    t;
+   std::atomic<int>     ran(0);
+   std::atomic<int64_t> late(0);
+   std::atomic<bool>    early(false), cancelled(false);
+   t.start();
+   t.atomic_post( [&](){
+      for( int i = 0; i < count; ++i )
+      {
+         auto deadline = clock::now() + std::chrono::milliseconds( 5 * i + 1 );
+         t.post_at( deadline, [&,deadline](){
+            int64_t l = std::chrono::duration_cast<std::chrono::microseconds>( clock::now() - deadline ).count();
+            early = early || l < 0;
+            if( l > late ) late = l;
+            ++ran;
+         } );
+      }
+      auto never = t.post_after( std::chrono::milliseconds( 5 * count ), [&](){ early = true; } );
+      t.post_after( std::chrono::milliseconds( 10 ), [&,never](){ cancelled = t.cancel( never ); } );
+   } );
+   while( ran < count ) usleep(1000);
+   usleep( 10*1000 * count );
+   t.stop();
+   t.join();
+   return early || !cancelled ? -1 : late.load();
+}
+
+int main( int argc, char** argv )
+{
+   int64_t timers = argc > 1 ? atoll( argv[1] ) : 1000L * 200;
+
+   check_wheel( timers );
+   std::cout << "thread timers ran at most " << thread_lateness( 20 ) << " us late" << std::endl;
+   return 0;
+}
@@ -0,0 +1,102 @@
+#include <disruptor/thread.hpp>
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+using namespace disruptor;
+
+/**
+ *  Two handlers on one disruptor::thread, each kept busy by a producer
+ *  that fills its ring, with events that cost the same.  Checks through
+ *  thread::usage() that they split the thread evenly at equal weights
+ *  and in favour of the heavier one otherwise, that long turns were
+ *  preempted and that usage() counted every event each handler saw.
+ */
+
+typedef std::chrono::steady_clock clock_type;
+
+/** keeps the thread busy for us microseconds */
+void spin( int64_t us )
+{
+   auto start = clock_type::now();
+   while( clock_type::now() - start < std::chrono::microseconds( us ) ) {}
+}
+
+/** @return the first handler's share of the time spent in handlers, or -1 if usage() was wrong */
+double run( uint32_t weight, int64_t event_us, int64_t ms )
+{
+   disruptor::thread t;
+   std::vector<write_cursor_ptr> writers;
+   std::vector<read_cursor_ptr>  readers;
+   // only touched by t
+   int64_t handled[2] = { 0, 0 };
+   for( int i = 0; i < 2; ++i )
+   {
+      auto w = std::make_shared<write_cursor>( i ? "light" : "heavy", 1024 );
+      auto r = std::make_shared<read_cursor>( i ? "light" : "heavy" );
+      r->follows(w);
+      w->follows(r);
+      writers.push_back(w);
+      readers.push_back(r);
+      t.add_cursor( r, [&,i]( int64_t begin, int64_t end )
+      {
+         for( auto pos = begin; pos < end; ++pos ) spin( event_us );
+         handled[i] += end - begin;
+         return end;
+      }, i ? 1 : weight );
+   }
+   t.start();
+
+   auto feed = [&]( int i )
+   {
+      auto w     = writers[i];
+      auto start = clock_type::now();
+      int64_t pos = w->begin();
+      while( clock_type::now() - start < std::chrono::milliseconds( ms ) )
+      {
+         w->wait_for( pos );
+         w->publish( pos++ );
+      }
+   };
+   std::thread heavy( feed, 0 ), light( feed, 1 );
+   heavy.join();
+   light.join();
+
+   // read on the thread, so that both describe the same moment
+   std::vector<thread::handler_usage> usage;
+   int64_t seen[2] = { 0, 0 };
+   t.async( [&](){ usage = t.usage(); seen[0] = handled[0]; seen[1] = handled[1]; } ).get();
+   t.stop();
+   t.join();
+
+   // the thread's own post handler is listed too
+   bool     right = true;
+   double   shares[2] = { 0, 0 };
+   uint32_t preemptions = 0, found = 0;
+   for( size_t i = 0; i < usage.size(); ++i )
+   {
+      for( int h = 0; h < 2; ++h )
+      {
+         if( usage[i].cursor != readers[h] ) continue;
+         right = right && usage[i].events == seen[h] && usage[i].weight == ( h ? 1 : weight );
+         shares[h]    = usage[i].share;
+         preemptions += usage[i].preemptions;
+         ++found;
+      }
+   }
+   right = right && found == 2 && shares[0] + shares[1] > 0;
+   double share = right ? shares[0] / ( shares[0] + shares[1] ) : 0;
+   std::cout << "weights " << weight << ":1, " << event_us << " us events: the first handler took "
+             << share * 100 << "% of the time, " << preemptions << " turns preempted" << std::endl;
+   return right && preemptions > 0 ? share : -1;
+}
+
+int main( int argc, char** argv )
+{
+   int64_t ms = argc > 1 ? atoll( argv[1] ) : 1000;
+
+   double even     = run( 1, 10, ms );
+   double weighted = run( 4, 10, ms );
+   // 4:1 would be 80%, allow for turns that end on a batch boundary
+   return even < 0.4 || even > 0.6 || weighted < 0.6;
+}
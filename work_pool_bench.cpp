@@ -0,0 +1,131 @@
+#include <disruptor/work_pool.hpp>
+#include <thread>
+#include <iostream>
+#include <sys/time.h>
+
+using namespace disruptor;
+
+#define SIZE 1024
+
+/**
+ *  One producer feeding a work_pool whose workers run an expensive
+ *  transform, followed by a reader that gates the producer on the
+ *  pool.  Every event must be transformed by exactly one worker.
+ */
+
+double now()
+{
+   struct timeval t;
+   gettimeofday(&t, NULL);
+   return t.tv_sec + ((double) t.tv_usec / 1000000);
+}
+
+/** stands in for work worth spreading over threads */
+uint64_t expensive( uint64_t x )
+{
+   for( int i = 0; i < 64; ++i ) x = x * 6364136223846793005ull + 1442695040888963407ull;
+   return x;
+}
+
+/** @return events per second, or 0 if an event was lost or done twice */
+double run( uint32_t num_workers, int64_t batch, uint64_t iterations )
+{
+   auto source = std::make_shared<ring_buffer<uint64_t,SIZE>>();
+   auto dest   = std::make_shared<ring_buffer<uint64_t,SIZE>>();
+   auto p      = std::make_shared<write_cursor>("write",SIZE);
+   auto pool   = std::make_shared<work_pool>("pool",num_workers,batch);
+   auto c      = std::make_shared<read_cursor>("c");
+
+   pool->follows(p);
+   c->follows(pool);
+   p->follows(c);
+
+   auto pub_thread = [=](){
+      auto pos = p->begin();
+      auto end = p->end();
+      for( uint64_t i = 0; i < iterations; ++i )
+      {
+         if( pos >= end )
+         {
+            end = p->wait_for(pos);
+         }
+         source->at(pos) = i;
+         p->publish(pos);
+         ++pos;
+      }
+      p->set_eof();
+   };
+
+   // written by one worker each
+   std::vector<uint64_t> sums( num_workers * 8 );
+   auto work_thread = [&]( uint32_t i ){
+      auto     w   = pool->worker(i);
+      uint64_t sum = 0;
+      try
+      {
+         while( true )
+         {
+            auto end = w->wait_next();
+            for( auto pos = w->begin(); pos < end; ++pos )
+            {
+               dest->at(pos) = expensive( source->at(pos) );
+               sum += source->at(pos);
+            }
+            w->publish( end - 1 );
+         }
+      }
+      catch ( const eof& ){}
+      sums[i*8] = sum;
+   };
+
+   auto read_thread = [=](){
+      try
+      {
+         uint64_t check = 0;
+         auto pos = c->begin();
+         auto end = c->end();
+         while( true )
+         {
+            if( pos == end )
+            {
+               c->publish(pos-1);
+               end = c->wait_for(end);
+            }
+            check ^= dest->at(pos);
+            ++pos;
+         }
+      }
+      catch ( const eof& ){}
+   };
+
+   double start = now();
+   std::vector<std::thread> workers;
+   for( uint32_t i = 0; i < num_workers; ++i )
+      workers.push_back( std::thread( work_thread, i ) );
+   std::thread rt( read_thread );
+   std::thread pt( pub_thread );
+
+   pt.join();
+   for( auto itr = workers.begin(); itr != workers.end(); ++itr )
+      itr->join();
+   rt.join();
+   double elapsed = now() - start;
+
+   uint64_t total = 0;
+   for( uint32_t i = 0; i < num_workers; ++i ) total += sums[i*8];
+   if( total != iterations * (iterations - 1) / 2 ) return 0;
+   return iterations / elapsed;
+}
+
+int main( int argc, char** argv )
+{
+   uint64_t iterations = argc > 1 ? atoll( argv[1] ) : 1000L * 1000L * 10;
+
+   std::cout.precision(15);
+   for( uint32_t workers = 1; workers <= 8; workers *= 2 )
+   {
+      std::cout << "1P-" << workers << "W batch 1:  " << run( workers, 1, iterations )  << " ops/secs" << std::endl;
+      std::cout << "1P-" << workers << "W batch 16: " << run( workers, 16, iterations ) << " ops/secs" << std::endl;
+   }
+   return 0;
+}